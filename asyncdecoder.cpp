@@ -0,0 +1,191 @@
+#include "asyncdecoder.h"
+
+#ifdef PTHREAD
+
+struct Decodejob {
+	int  id;
+	unsigned char *data;
+	int  size;
+	long long deadline;	//Timer::nowMillis(), 0 for none
+	bool cancelled;
+	Decoder *decoder;	//set while running, for cancel()
+	Decodecallback callback;
+	void *arg;
+	Asyncdecoder *owner;
+};
+
+/* c function for Workqueue */
+void
+asyncWorker(void *arg, int worker)
+{
+	Decodejob *job = (Decodejob*) arg;
+	job->owner->runJob(job, worker);
+}
+
+Asyncdecoder::Asyncdecoder(Config *options, int _workers, int queue_size)
+{
+	queue = new Workqueue(_workers, queue_size);
+	own_queue = true;
+	init(options);
+}
+
+Asyncdecoder::Asyncdecoder(Config *options, Workqueue *shared)
+{
+	queue = shared;
+	own_queue = false;
+	init(options);
+}
+
+void
+Asyncdecoder::init(Config *options)
+{
+	next_id  = 1;
+	inflight = 0;
+	workers  = queue->getWorkers();
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&idle, NULL);
+	decoders = new Decoder*[workers];
+	for(int i = 0; i < workers; i++){
+		decoders[i] = new Decoder((unsigned char *)NULL, 0);
+		decoders[i]->getConfig()->copyOptions(options);
+		decoders[i]->getConfig()->THREADS = 1; //parallel across images, not within one
+	}
+}
+
+Asyncdecoder::~Asyncdecoder()
+{
+	pthread_mutex_lock(&lock);
+	while( inflight > 0 ) pthread_cond_wait(&idle, &lock);
+	pthread_mutex_unlock(&lock);
+	if(own_queue) delete queue;
+	for(int i = 0; i < workers; i++) delete decoders[i];
+	delete [] decoders;
+	pthread_cond_destroy(&idle);
+	pthread_mutex_destroy(&lock);
+}
+
+Decodejob*
+Asyncdecoder::newJob(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout)
+{
+	Decodejob *job = new Decodejob;
+	job->data      = data;
+	job->size      = size;
+	job->deadline  = timeout > 0 ? Timer::nowMillis() + timeout : 0;
+	job->cancelled = false;
+	job->decoder   = NULL;
+	job->callback  = callback;
+	job->arg       = arg;
+	job->owner     = this;
+	pthread_mutex_lock(&lock);
+	job->id = next_id++;
+	jobs[job->id] = job;
+	inflight++;
+	pthread_mutex_unlock(&lock);
+	return job;
+}
+
+//job is done (or never queued), forget it and wake up the destructor
+void
+Asyncdecoder::dropJob(Decodejob *job)
+{
+	pthread_mutex_lock(&lock);
+	jobs.erase(job->id);
+	inflight--;
+	if( inflight == 0 ) pthread_cond_broadcast(&idle);
+	pthread_mutex_unlock(&lock);
+	delete job;
+}
+
+//blocks while the queue is full, returns the job id or -1 on shutdown
+int
+Asyncdecoder::submit(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout)
+{
+	Decodejob *job = newJob(data, size, callback, arg, timeout);
+	int id = job->id;
+	if( ! queue->submit(asyncWorker, (void *)job) ){
+		dropJob(job);
+		return -1;
+	}
+	return id;
+}
+
+//never blocks, returns the job id or -1 if the queue is full
+int
+Asyncdecoder::trySubmit(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout)
+{
+	Decodejob *job = newJob(data, size, callback, arg, timeout);
+	int id = job->id;
+	if( ! queue->trySubmit(asyncWorker, (void *)job) ){
+		dropJob(job);
+		return -1;
+	}
+	return id;
+}
+
+bool
+Asyncdecoder::cancel(int id)
+{
+	bool found = false;
+	pthread_mutex_lock(&lock);
+	map<int, Decodejob*>::iterator it = jobs.find(id);
+	if( it != jobs.end() ){
+		it->second->cancelled = true;
+		if( it->second->decoder != NULL ) it->second->decoder->cancel();
+		found = true;
+	}
+	pthread_mutex_unlock(&lock);
+	return found;
+}
+
+int
+Asyncdecoder::pending()
+{
+	pthread_mutex_lock(&lock);
+	int count = inflight;
+	pthread_mutex_unlock(&lock);
+	return count;
+}
+
+void
+Asyncdecoder::runJob(Decodejob *job, int worker)
+{
+	Decoderesult result;
+	result.id  = job->id;
+	result.arg = job->arg;
+	for(int i = 0; i < 12; i++) result.tag[i] = -1;
+
+	Decoder *decoder = decoders[worker];
+	decoder->setImage(job->data, job->size);
+	decoder->setDeadline(job->deadline);
+
+	pthread_mutex_lock(&lock);
+	job->decoder = decoder;
+	if( job->cancelled ) decoder->cancel();
+	pthread_mutex_unlock(&lock);
+
+	bool ok = decoder->processTag();
+	decoder->copyStats(&result.stats);
+
+	pthread_mutex_lock(&lock);
+	job->decoder = NULL;
+	bool cancelled = job->cancelled;
+	pthread_mutex_unlock(&lock);
+
+	if( decoder->isStopped() ){
+		result.status = cancelled ? DECODE_CANCELLED : DECODE_EXPIRED;
+	}else if( ! ok ){
+		result.status = DECODE_INVALID;
+	}else{
+		decoder->copyTag(result.tag);
+		result.status = DECODE_OK;
+		for(int i = 0; i < 12; i++) { 
+			if( result.tag[i] < 0 ) result.status = DECODE_NOTFOUND;
+		}
+	}
+	decoder->setImage(NULL, 0);
+
+	job->callback(&result);
+	dropJob(job);
+}
+
+#endif /* PTHREAD */
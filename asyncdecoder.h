@@ -0,0 +1,75 @@
+#ifndef _ASYNCDECODER_H_INCLUDED
+#define _ASYNCDECODER_H_INCLUDED
+
+#include <map>
+
+#include "decoder.h"
+#include "workqueue.h"
+#include "common.h"
+
+#ifdef PTHREAD
+
+#define DECODE_OK        0	//all 12 digits decoded
+#define DECODE_NOTFOUND  1	//image decoded but no complete tag in it
+#define DECODE_INVALID   2	//image could not be read
+#define DECODE_CANCELLED 3	//cancel() before or during the decode
+#define DECODE_EXPIRED   4	//deadline passed before or during the decode
+
+using namespace std;
+
+struct Decoderesult {
+	int  id;		//as returned by submit()
+	int  status;		//DECODE_OK ...
+	int  tag[12];		//-1 for digits not decoded
+	Stats stats;		//stage timings and counts of this decode
+	void *arg;		//as given to submit()
+};
+
+//called on a worker thread, result is valid only during the call
+typedef void (*Decodecallback)(Decoderesult *result);
+
+struct Decodejob;
+
+/*
+* Non blocking front for the decoder: submit() queues an in memory jpeg and 
+* returns, the callback is run on a worker thread once the tag is decoded. 
+* Each worker keeps its own Decoder, created once with the given options.
+* 
+* The workers are either owned or a shared Workqueue (which must outlive me).
+* cancel() and deadlines take effect before the decode starts or between the
+* decoder stages (after Threshold, after Border), the callback is always run.
+*/
+class Asyncdecoder
+{
+
+public:
+	Asyncdecoder(Config *options, int workers, int queue_size);
+	Asyncdecoder(Config *options, Workqueue *shared);
+	~Asyncdecoder();			//waits for all submitted decodes 
+
+	//data must stay valid until the callback, timeout in msecs (0 = none)
+	int  submit(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout);
+	int  trySubmit(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout);
+	bool cancel(int id);			//false if already completed or unknown
+	int  pending();
+	void runJob(Decodejob *job, int worker); //worker thread body, not for direct use
+
+private:
+	Workqueue *queue;
+	bool own_queue;
+	Decoder **decoders;
+	int  workers;
+	int  next_id;
+	int  inflight;
+	map<int, Decodejob*> jobs;
+	pthread_mutex_t lock;
+	pthread_cond_t  idle;
+
+	void init(Config *options);
+	Decodejob* newJob(unsigned char *data, int size, Decodecallback callback, void *arg, int timeout);
+	void dropJob(Decodejob *job);
+};
+
+#endif /* PTHREAD */
+
+#endif /* _ASYNCDECODER_H_INCLUDED */
@@ -0,0 +1,457 @@
+/*
+* Stage micro benchmarks
+*
+*	bench imagefile.jpg [repetitions] [j|p|jp]
+*
+* Runs each decoder stage in isolation on the given image, untimed setup
+* is redone for every repetition so a stage always sees the same input.
+* Reports time per repetition (mean, stddev, min, median), ns/pixel,
+* throughput and operator new allocations (libjpeg malloc is not counted).
+* j: JSON output instead of the table
+* p: hardware counters per stage (cycles, IPC, cache and branch miss rates,
+*    stalled cycles), only the timed run() is counted. Unavailable counters
+*    are reported as n/a (null in JSON), the timings are still measured.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "decoder.h"
+#include "perfcounters.h"
+#include "benchalloc.h"
+
+struct Benchresult {
+	string name;
+	int    reps;
+	long long pixels;		//pixels processed per repetition
+	double mean, stddev, min, median; //usecs
+	double allocs, alloc_bytes;	//per repetition
+	double perf[PERF_COUNTERS];	//per repetition, -1 if unavailable
+};
+
+static Perfcounters *bench_perf = NULL;	//NULL when not requested
+
+/*
+* one stage under test: setup() untimed, run() timed, teardown() untimed
+* all state is kept in the case itself
+*/
+struct Benchcase {
+	string name;
+	Config *config;
+	Tagimage *tagimage;
+	Threshold *threshold;
+	Border *border;
+	Shape *shapes;
+	Shape *anchor;
+	bool *edgemap;		//saved edge map, Border consumes the one in Config
+	int  edgemap_size;
+	int  grid_width, grid_height;	//Pattern and Shape change the grid size in Config
+	int  window;
+	int  nshapes;
+	int  tag[12];
+	long long pixels;
+	void (*setup)(Benchcase *c);
+	void (*run)(Benchcase *c);
+	void (*teardown)(Benchcase *c);
+};
+
+static void nop(Benchcase *) { }
+
+//Tagimage decode
+static void runDecode(Benchcase *c)
+{
+	c->tagimage = new Tagimage(c->config);
+}
+
+static void endDecode(Benchcase *c)
+{
+	delete c->tagimage;
+	c->tagimage = NULL;
+}
+
+//Threshold, on a decoded image kept for all repetitions
+static void beginThreshold(Benchcase *c)
+{
+	c->threshold = new Threshold(c->config, c->tagimage);
+	c->threshold->beginEdgemap();
+	c->pixels = (long long)c->config->GRID_WIDTH * c->config->GRID_HEIGHT;
+}
+
+static void runEdgemapOpt(Benchcase *c)
+{
+	c->threshold->computeEdgemapOpt(c->window, c->config->THRESHOLD_OFFSET);
+}
+
+static void runEdgemap(Benchcase *c)
+{
+	c->threshold->computeEdgemap(c->window, c->config->THRESHOLD_OFFSET, 0, c->config->GRID_HEIGHT);
+}
+
+//Threshold setup, resolveScaling() and the Downscaler resampling
+static void runScaling(Benchcase *c)
+{
+	c->threshold = new Threshold(c->config, c->tagimage);
+}
+
+static void endScaling(Benchcase *c)
+{
+	delete c->threshold;
+	c->threshold = NULL;
+	c->config->freeEdgemap();
+}
+
+static void endThreshold(Benchcase *c)
+{
+	c->threshold->endEdgemap();
+	delete c->threshold;
+	c->threshold = NULL;
+	c->config->freeEdgemap();
+}
+
+//Border, Shape and Pattern, on a fresh copy of the saved edge map
+static void beginBorder(Benchcase *c)
+{
+	c->config->GRID_WIDTH  = c->grid_width;
+	c->config->GRID_HEIGHT = c->grid_height;
+	c->config->EDGE_MAP = new bool[c->edgemap_size];
+	memcpy(c->config->EDGE_MAP, c->edgemap, c->edgemap_size * sizeof(bool));
+	c->shapes = new Shape[c->config->MAX_SHAPES];
+	c->anchor = new Shape(c->config);
+	c->border = new Border(c->config, c->shapes, c->anchor);
+	c->pixels = c->edgemap_size;
+}
+
+static void runBorder(Benchcase *c)
+{
+	c->nshapes = c->border->findShapes();
+}
+
+static void endBorder(Benchcase *c)
+{
+	if(c->border != NULL) delete c->border;
+	c->border = NULL;
+	delete c->anchor;
+	delete [] c->shapes;
+}
+
+static void beginShapes(Benchcase *c)
+{
+	beginBorder(c);
+	runBorder(c);
+	delete c->border;
+	c->border = NULL;
+}
+
+static void runRotate(Benchcase *c)
+{
+	int cx = c->config->GRID_WIDTH/2, cy = c->config->GRID_HEIGHT/2;
+	for(int i = 0; i < c->nshapes; i++) c->shapes[i].rotateShape(cx, cy, 0, 0, 10);
+	c->anchor->rotateShape(cx, cy, 0, 0, 10);
+}
+
+static void runPattern(Benchcase *c)
+{
+	if(c->nshapes < 12) return;
+	Pattern* pattern = new Pattern(c->config, c->shapes, c->nshapes, c->anchor);
+	pattern->findCode(c->tag);
+	delete pattern;
+}
+
+static Benchresult
+measure(Benchcase *c, int reps)
+{
+	Benchresult r;
+	vector<double> times;
+	int warmup = reps/10 > 0 ? reps/10 : 1;
+	long long allocs = 0, bytes = 0;
+
+	for(int i = 0; i < warmup + reps; i++){
+		c->setup(c);
+		if( bench_perf != NULL && i == warmup ) bench_perf->reset();
+		long long a = bench_allocs, b = bench_alloc_bytes;
+		if( bench_perf != NULL ) bench_perf->start();
+		long long start = Timer::now();
+		c->run(c);
+		long long elapsed = Timer::now() - start;
+		if( bench_perf != NULL ) bench_perf->stop();
+		if( i >= warmup ){
+			times.push_back((double)elapsed);
+			allocs += bench_allocs - a;
+			bytes  += bench_alloc_bytes - b;
+		}
+		c->teardown(c);
+	}
+
+	double sum = 0, sq = 0;
+	for(int i = 0; i < reps; i++) sum += times[i];
+	r.mean = sum / reps;
+	for(int i = 0; i < reps; i++) sq += (times[i] - r.mean) * (times[i] - r.mean);
+	r.stddev = reps > 1 ? sqrt(sq / (reps - 1)) : 0;
+	sort(times.begin(), times.end());
+	r.min    = times[0];
+	r.median = times[reps/2];
+	r.name   = c->name;
+	r.reps   = reps;
+	r.pixels = c->pixels;
+	r.allocs = (double)allocs / reps;
+	r.alloc_bytes = (double)bytes / reps;
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		long long count = bench_perf != NULL ? bench_perf->get(i) : -1;
+		r.perf[i] = count >= 0 ? (double)count / reps : -1;
+	}
+	return r;
+}
+
+static void
+initCase(Benchcase *c, string name, Config *config)
+{
+	c->name = name;
+	c->config = config;
+	c->tagimage = NULL;
+	c->threshold = NULL;
+	c->border = NULL;
+	c->shapes = NULL;
+	c->anchor = NULL;
+	c->edgemap = NULL;
+	c->edgemap_size = 0;
+	c->grid_width = config->GRID_WIDTH;
+	c->grid_height = config->GRID_HEIGHT;
+	c->window = config->THRESHOLD_WINDOW_SIZE;
+	c->nshapes = 0;
+	c->pixels = 0;
+	c->setup = nop;
+	c->run = nop;
+	c->teardown = nop;
+}
+
+//a/b from the per repetition counts, -1 if either is unavailable
+static double
+perfRatio(Benchresult &r, int a, int b)
+{
+	if( r.perf[a] < 0 || r.perf[b] <= 0 ) return -1;
+	return r.perf[a] / r.perf[b];
+}
+
+static void
+printPerfJSON(Benchresult &r)
+{
+	cout << ", \"perf\": {";
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		cout << "\"" << Perfcounters::name(i) << "\": ";
+		if( r.perf[i] < 0 ) cout << "null, ";
+		else cout << r.perf[i] << ", ";
+	}
+	double ratios[5] = { perfRatio(r, PERF_INSTRUCTIONS, PERF_CYCLES),
+		perfRatio(r, PERF_CACHE_MISSES, PERF_CACHE_REFERENCES),
+		perfRatio(r, PERF_BRANCH_MISSES, PERF_BRANCHES),
+		perfRatio(r, PERF_STALLED_FRONTEND, PERF_CYCLES),
+		perfRatio(r, PERF_STALLED_BACKEND, PERF_CYCLES) };
+	const char *names[5] = { "ipc", "cache_miss_rate", "branch_miss_rate",
+		"stalled_frontend_rate", "stalled_backend_rate" };
+	for(int i = 0; i < 5; i++){
+		cout << "\"" << names[i] << "\": ";
+		if( ratios[i] < 0 ) cout << "null";
+		else cout << ratios[i];
+		cout << (i < 4 ? ", " : "}");
+	}
+}
+
+static void
+printPerfValue(double value, int width, bool percent)
+{
+	if( value < 0 ) cout << setw(width) << "n/a";
+	else if( percent ) cout << setw(width - 1) << value * 100 << "%";
+	else cout << setw(width) << value;
+}
+
+static void
+printPerfTable(vector<Benchresult> &results)
+{
+	cout << endl;
+	cout << setw(24) << left << "stage" << right << setw(14) << "cycles" << setw(14) << "instr"
+		<< setw(7) << "IPC" << setw(10) << "cache-m" << setw(10) << "branch-m"
+		<< setw(10) << "stall-fe" << setw(10) << "stall-be" << endl;
+	for(size_t i = 0; i < results.size(); i++){
+		Benchresult &r = results[i];
+		cout << setw(24) << left << r.name << right << fixed << setprecision(0);
+		printPerfValue(r.perf[PERF_CYCLES], 14, false);
+		printPerfValue(r.perf[PERF_INSTRUCTIONS], 14, false);
+		cout << setprecision(2);
+		printPerfValue(perfRatio(r, PERF_INSTRUCTIONS, PERF_CYCLES), 7, false);
+		cout << setprecision(1);
+		printPerfValue(perfRatio(r, PERF_CACHE_MISSES, PERF_CACHE_REFERENCES), 10, true);
+		printPerfValue(perfRatio(r, PERF_BRANCH_MISSES, PERF_BRANCHES), 10, true);
+		printPerfValue(perfRatio(r, PERF_STALLED_FRONTEND, PERF_CYCLES), 10, true);
+		printPerfValue(perfRatio(r, PERF_STALLED_BACKEND, PERF_CYCLES), 10, true);
+		cout << endl;
+	}
+}
+
+static void
+printResults(vector<Benchresult> &results, string image, bool json)
+{
+	if( json ){
+		cout << "{\"image\": \"" << image << "\", \"benchmarks\": [" << endl;
+		for(size_t i = 0; i < results.size(); i++){
+			Benchresult &r = results[i];
+			cout << "  {\"name\": \"" << r.name << "\", \"reps\": " << r.reps
+				<< ", \"pixels\": " << r.pixels
+				<< ", \"mean_us\": " << r.mean << ", \"stddev_us\": " << r.stddev
+				<< ", \"min_us\": " << r.min << ", \"median_us\": " << r.median
+				<< ", \"ns_per_pixel\": " << (r.pixels > 0 ? r.mean * 1000.0 / r.pixels : 0)
+				<< ", \"mpixels_per_sec\": " << (r.mean > 0 ? r.pixels / r.mean : 0)
+				<< ", \"allocs\": " << r.allocs << ", \"alloc_bytes\": " << r.alloc_bytes;
+			if( bench_perf != NULL ) printPerfJSON(r);
+			cout << "}" << (i + 1 < results.size() ? "," : "") << endl;
+		}
+		cout << "]}" << endl;
+		return;
+	}
+	cout << setw(24) << left << "stage" << right << setw(10) << "mean us" << setw(10) << "stddev"
+		<< setw(10) << "min" << setw(10) << "median" << setw(10) << "ns/pix"
+		<< setw(10) << "Mpix/s" << setw(10) << "allocs" << setw(12) << "bytes" << endl;
+	for(size_t i = 0; i < results.size(); i++){
+		Benchresult &r = results[i];
+		cout << setw(24) << left << r.name << right << fixed << setprecision(1)
+			<< setw(10) << r.mean << setw(10) << r.stddev
+			<< setw(10) << r.min << setw(10) << r.median
+			<< setprecision(2)
+			<< setw(10) << (r.pixels > 0 ? r.mean * 1000.0 / r.pixels : 0)
+			<< setw(10) << (r.mean > 0 ? r.pixels / r.mean : 0)
+			<< setprecision(0)
+			<< setw(10) << r.allocs << setw(12) << r.alloc_bytes << endl;
+	}
+	if( bench_perf != NULL ) printPerfTable(results);
+}
+
+int main(int argc,char **argv) {
+	if( argc < 2 ){
+		cerr << "Usage: " << argv[0] << " imagefile.jpg [repetitions] [j|p|jp]" << endl;
+		return 1;
+	}
+	int reps = argc >= 3 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 20;
+	bool json = argc >= 4 && strchr(argv[3], 'j') != NULL;
+	if( argc >= 4 && strchr(argv[3], 'p') != NULL ){
+		bench_perf = new Perfcounters();
+		if( ! bench_perf->open() ){
+			cerr << "hardware counters unavailable (" << bench_perf->getError() << "), timings only" << endl;
+			delete bench_perf;
+			bench_perf = NULL;
+		}else if( bench_perf->getError() != "" ){
+			cerr << "some hardware counters unavailable (" << bench_perf->getError() << ")" << endl;
+		}
+	}
+
+	Config *config = new Config();
+	config->TAG_IMAGE_FILE = argv[1];
+	config->ARGS_OK = true;
+	config->THREADS = 1;
+
+	vector<Benchresult> results;
+	Benchcase c;
+
+	//image size at full resolution
+	config->JPG_SCALE = false;
+	Tagimage *tagimage = new Tagimage(config);
+	if( ! tagimage->isValid() ) return 1;
+	int width = tagimage->getWidth(), height = tagimage->getHeight();
+	delete tagimage;
+	int longer = width > height ? width : height;
+
+	//Tagimage decode at each JPG_SCALE denominator
+	int denoms[4] = { 1, 2, 4, 8 };
+	for(int i = 0; i < 4; i++){
+		config->JPG_SCALE = denoms[i] > 1;
+		config->PIXMAP_SCALE_SIZE = longer / denoms[i];
+		if( config->PIXMAP_SCALE_SIZE <= config->THRESHOLD_WINDOW_SIZE ) continue;
+		for(int raw = 1; raw >= 0; raw--){ //Y plane only and the grayscale scanline path
+			config->JPG_RAW_LUMA = raw == 1;
+			ostringstream name;
+			name << "decode-1/" << denoms[i] << (raw ? "" : "-scanline");
+			initCase(&c, name.str(), config);
+			c.pixels = (long long)width * height; //per source pixel, whatever the output size
+			c.run = runDecode;
+			c.teardown = endDecode;
+			results.push_back(measure(&c, reps));
+		}
+		config->JPG_RAW_LUMA = true;
+	}
+
+	//resampling to the default PIXMAP_SCALE_SIZE, from the full and the JPG_SCALE image
+	Config defaults;
+	for(int jpg = 0; jpg < 2; jpg++){
+		config->JPG_SCALE = jpg == 1;
+		config->PIXMAP_SCALE_SIZE = defaults.PIXMAP_SCALE_SIZE;
+		tagimage = new Tagimage(config);
+		for(int fast = 1; fast >= 0; fast--){
+			config->PIXMAP_FAST_SCALE = fast == 1;
+			initCase(&c, string(fast ? "scale-fast" : "scale-slow") + (jpg ? "-jpg" : "-full"), config);
+			c.tagimage = tagimage;
+			c.pixels = (long long)tagimage->getWidth() * tagimage->getHeight();
+			c.run = runScaling;
+			c.teardown = endScaling;
+			results.push_back(measure(&c, reps));
+		}
+		config->PIXMAP_FAST_SCALE = defaults.PIXMAP_FAST_SCALE;
+		delete tagimage;
+	}
+
+	//thresholding on the default JPG_SCALE output, unscaled so both variants apply
+	config->JPG_SCALE = defaults.JPG_SCALE;
+	config->PIXMAP_SCALE_SIZE = defaults.PIXMAP_SCALE_SIZE;
+	tagimage = new Tagimage(config);
+	config->PIXMAP_SCALE_SIZE = tagimage->getWidth() > tagimage->getHeight() ?
+		tagimage->getWidth() : tagimage->getHeight();
+	int windows[4] = { 16, 32, 48, 64 };
+	for(int i = 0; i < 4; i++){
+		ostringstream opt, generic;
+		opt << "edgemap-opt-w" << windows[i];
+		generic << "edgemap-w" << windows[i];
+		initCase(&c, opt.str(), config);
+		c.tagimage = tagimage;
+		c.window = windows[i];
+		c.setup = beginThreshold;
+		c.run = runEdgemapOpt;
+		c.teardown = endThreshold;
+		results.push_back(measure(&c, reps));
+		c.name = generic.str();
+		c.run = runEdgemap;
+		results.push_back(measure(&c, reps));
+	}
+
+	//edge map of the default pipeline for the later stages
+	config->PIXMAP_SCALE_SIZE = defaults.PIXMAP_SCALE_SIZE;
+	Threshold *threshold = new Threshold(config, tagimage);
+	threshold->computeEdgemap();
+	delete threshold;
+	delete tagimage; //frees PIXBUF
+	initCase(&c, "", config);
+	c.edgemap_size = config->GRID_WIDTH * config->GRID_HEIGHT;
+	c.edgemap = new bool[c.edgemap_size];
+	memcpy(c.edgemap, config->EDGE_MAP, c.edgemap_size * sizeof(bool));
+	config->freeEdgemap();
+
+	c.name = "border-findshapes";
+	c.setup = beginBorder;
+	c.run = runBorder;
+	c.teardown = endBorder;
+	results.push_back(measure(&c, reps));
+
+	c.name = "shape-rotate";
+	c.setup = beginShapes;
+	c.run = runRotate;
+	results.push_back(measure(&c, reps));
+
+	c.name = "pattern-findcode";
+	c.run = runPattern;
+	results.push_back(measure(&c, reps));
+
+	delete [] c.edgemap;
+	delete config;
+
+	printResults(results, argv[1], json);
+	if( bench_perf != NULL ) delete bench_perf;
+	return 0;
+}
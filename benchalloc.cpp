@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include <new>
+#include "benchalloc.h"
+
+long long bench_allocs = 0;
+long long bench_alloc_bytes = 0;
+
+void* operator new(size_t size)
+{
+	bench_allocs++;
+	bench_alloc_bytes += size;
+	void *p = malloc(size > 0 ? size : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+	free(p);
+}
+
+//the sized forms C++14 calls, else they go to the library
+void operator delete(void *p, size_t) throw()
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) throw()
+{
+	free(p);
+}
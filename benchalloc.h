@@ -0,0 +1,13 @@
+#ifndef _BENCHALLOC_H_INCLUDED
+#define _BENCHALLOC_H_INCLUDED
+
+/*
+* operator new/delete replaced to count the allocations of bench, linked
+* into bench only, single threaded. In their own file so the compiler does
+* not inline the free() of delete next to a new expression and take them
+* for a mismatched pair.
+*/
+extern long long bench_allocs;
+extern long long bench_alloc_bytes;
+
+#endif /* _BENCHALLOC_H_INCLUDED */
@@ -7,11 +7,14 @@ Border::Border(Config *_config, Shape* _shapes, Shape* _anchor)
 	anchor = _anchor;
 
 
+#ifndef PRODUCTION
 	debug       = config->DEBUG;
 	pixdebug    = config->CHECK_VISUAL_DEBUG();
 	anchordebug = config->ANCHOR_DEBUG;
+#endif
 	max_anchors = config->MAX_ANCHORS;
 	max_shapes  = config->MAX_SHAPES;
+	all_anchors = false;
 
 	for(int i = 0; i < max_shapes; i++) shapes[i].setConfig(config); 
 
@@ -39,6 +42,7 @@ Border::Border(Config *_config, Shape* _shapes, Shape* _anchor)
 	h_midpoints_holder = new int[width];
 	for(int i=0; i<height; i++) w_midpoints_holder[i] = 0;
 	for(int i=0; i<width; i++)  h_midpoints_holder[i] = 0;
+	config->trackAlloc(2 * ((long long)width + height) * sizeof(int));
 
 	if(pixdebug) { 
 		pixmap->resizePixmap(config->GRID_WIDTH, config->GRID_HEIGHT);
@@ -57,6 +61,7 @@ Border::~Border()
 	delete [] heights_holder;
 	delete [] w_midpoints_holder;
 	delete [] h_midpoints_holder;
+	config->trackFree(2 * ((long long)width + height) * sizeof(int));
 }
 
 Shape*
@@ -71,6 +76,42 @@ Border::getAnchor()
 	return anchor;
 }
 
+/* 
+* several tags in one image: room for max_shapes shapes (shapes must hold 
+* that many), smaller shapes for the smaller tags (Config::TAGS_PER_SIDE), 
+* and the anchor checks go on after the first anchor, every candidate 
+* kept in anchors too
+*/
+void
+Border::collectAnchors(int _max_shapes)
+{
+	for(int i = max_shapes; i < _max_shapes; i++) shapes[i].setConfig(config);
+	max_shapes  = _max_shapes;
+	all_anchors = true;
+	if( config->TAGS_PER_SIDE > 1 ) min_threshold /= config->TAGS_PER_SIDE;
+}
+
+static bool
+biggerShape(Shape *a, Shape *b)
+{
+	return a->size() > b->size();
+}
+
+int
+Border::copyAnchors(Shape *to, int max)
+{
+	vector<Shape*> found;
+	for(int i = 0; i < shapes_found; i++)  if( shapes[i].isAnchor() )  found.push_back(&shapes[i]);
+	for(int i = 0; i < anchors_found; i++) if( anchors[i].isAnchor() ) found.push_back(&anchors[i]);
+	stable_sort(found.begin(), found.end(), biggerShape);
+	int n = (int)found.size() < max ? (int)found.size() : max;
+	for(int i = 0; i < n; i++){
+		to[i].setConfig(config);
+		to[i].copyShape(found[i]);
+	}
+	return n;
+}
+
 int
 Border::getShapeCount()
 {
@@ -80,9 +121,16 @@ Border::getShapeCount()
 int
 Border::findShapes()
 {
+	Stats *stats = config->STATS;
+	long long mark = Timer::now();
 	getBorders();
+	stats->border = Timer::now() - mark;
+	stats->shapes_kept = shapes_found;
+	stats->anchor_candidates = anchors_found;
 	if( foundShapes() ) { 
+		mark = Timer::now();
 		if(! foundAnchor()) findAnchor(); 
+		stats->anchor = Timer::now() - mark;
 		if(foundAnchor()) return shapes_found;
 	}
 	return 0;
@@ -108,6 +156,7 @@ Border::getBorders()
 			if( isEdge(i, j) ){
 
 				BORDERCOLOR = (count++%4)+3; //FIXME: Remove after debug
+				config->STATS->shapes_traced++;
 
 				// reset globals
 				min_x = i; min_y = j; max_x = i; max_y = j;
@@ -247,6 +296,7 @@ Border::anchorCheck()
 
 	if( current->isAnchor() ){ //level=0 strictest select as final anchor
 		if(anchordebug) cout << current->size() << "-" << anchor->size() << endl;
+		if( all_anchors ) addAnchor();
 		if( current->size() > anchor->size() ){ //larger block over rides last found anchor 
 			anchor->setValues(xmap, ymap, seg_count);
 			anchor->setBounds(min_x, min_y, max_x, max_y);
@@ -323,17 +373,8 @@ Border::findAnchor()
 void
 Border::copyAnchor(Shape *shape)
 {
-	int mnx =0, mny = 0, mxx = 0, mxy = 0;
-	mnx = shape->getminx();
-	mny = shape->getminy();
-	mxx = shape->getmaxx();
-	mxy = shape->getmaxy();
-	anchor->copyValues(shape->getxmap(), shape->getymap(), shape->getmapcount());
-	anchor->setBounds(mnx, mny, mxx, mxy);
-	anchor->setCenter( mnx + (mxx - mnx)/2, mny + (mxy - mny)/2 );
+	anchor->copyShape(shape);
 	//anchor->setGrid( pixmap->getWidth(),  pixmap->getHeight() );
-	anchor->copyWidthValues(shape->getWidthValues(), shape->getWMidpointValues(), mny, mxy);
-	anchor->copyHeightValues(shape->getHeightValues(), shape->getHMidpointValues(), mnx, mxx);
 }
 
 void
@@ -386,7 +427,7 @@ Border::addShape()
 void
 Border::filterAnchor()
 {
-	if(!foundAnchor()) anchorCheck();
+	if(all_anchors || !foundAnchor()) anchorCheck();
 }
 
 /*
@@ -5,6 +5,7 @@
 #include "pixmap.h"
 #include "shape.h"
 #include "pattern.h"
+#include "timer.h"
 #include "common.h"
 
 #define BLACK 0
@@ -25,6 +26,8 @@ public:
 	Border(Config *config, Shape *shapes, Shape *anchor);
 	~Border();
 	int findShapes();
+	void collectAnchors(int max_shapes);	//keep every anchor candidate (Decoder::processTags)
+	int  copyAnchors(Shape *to, int max);	//the biggest candidates, after findShapes()
 	int getShapeCount();
 	Shape* getShapes();
 	Shape* getAnchor();
@@ -49,6 +52,7 @@ private:
 	int mapcount;
 	int max_shapes;
 	int max_anchors;
+	bool all_anchors;
 
 	//globals for recursion
 	vector<int> xmap; //dynamic holder for shape x values
@@ -76,9 +80,15 @@ private:
 	void resetWidthsAndHeights();
 
 	//debug only
+#ifdef PRODUCTION
+	static const bool debug = false;
+	static const bool pixdebug = false;
+	static const bool anchordebug = false;
+#else
 	bool debug;
 	bool pixdebug;
 	bool anchordebug;
+#endif
 	int BORDERCOLOR; //FIXME: remove after debug
 
 	void d_debugShapes();
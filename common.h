@@ -2,6 +2,13 @@
 #define _COMMON_H_INCLUDED
 
 #define NDEBUG //Remove asserts
+
+/*
+* PRODUCTION builds (-DPRODUCTION) compile the debug logging and the 
+* visual debug paths away: the debug flags of Threshold, Border, Shape 
+* and Pattern are then constant false instead of copies of the Config 
+* options, so the inner loops carry no debug branches at all 
+*/
 #include <assert.h>
 #include <iostream>
 #include "config.h"
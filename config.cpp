@@ -1,12 +1,31 @@
 #include "config.h"
+#include <fstream>
+#include <sstream>
 
 const int  Config::MAX_ANCHORS=12;
 const int  Config::MAX_SHAPES=48;
+const int  Config::MAX_TAGS=16;
+const int  Config::MAX_IMAGE_PIXELS=100000000;
 const bool Config::PLATFORM_CPP = false;
 const bool Config::PLATFORM_CPP_MAGICK = false;
 const bool Config::PLATFORM_CPP_SYMBIAN = false;
 const bool Config::PLATFORM_CPP_SYMBIAN_S60 = false;
 
+//the options a profile holds, the threshold and scale tunables
+static const struct {
+	const char *name;
+	int Config::*option;
+} profile_options[] = {
+	{ "THRESHOLD_WINDOW_SIZE",     &Config::THRESHOLD_WINDOW_SIZE },
+	{ "THRESHOLD_OFFSET",          &Config::THRESHOLD_OFFSET },
+	{ "PIXMAP_SCALE_SIZE",         &Config::PIXMAP_SCALE_SIZE },
+	{ "PIXMAP_SCALE_FLEX_PERCENT", &Config::PIXMAP_SCALE_FLEX_PERCENT },
+	{ "ANCHOR_BOX_FLEX_PERCENT",   &Config::ANCHOR_BOX_FLEX_PERCENT },
+	{ "SHAPE_BOX_FLEX_PERCENT",    &Config::SHAPE_BOX_FLEX_PERCENT },
+	{ "PATTERN_CONFIDENCE_FLOOR",  &Config::PATTERN_CONFIDENCE_FLOOR }
+};
+static const int PROFILE_OPTIONS = sizeof(profile_options) / sizeof(profile_options[0]);
+
 Config::Config()
 {
 	THREADS = 1; //single threaded by default
@@ -14,28 +33,50 @@ Config::Config()
 	THRESHOLD_WINDOW_SIZE = 48;
 	THRESHOLD_OFFSET = 10;
 	THRESHOLD_RGB_FACTOR = 1; //JPEG=1 IMAGEMAGIC=256 JSE=1 JME=1 
+	THRESHOLD_RETRIES = 0;
+	THRESHOLD_RETRY_OFFSETS[0] = 5; //nearest to THRESHOLD_OFFSET first
+	THRESHOLD_RETRY_OFFSETS[1] = 15;
+	THRESHOLD_RETRY_OFFSETS[2] = 0;
+	THRESHOLD_RETRY_OFFSETS[3] = 20;
 	
 
 	PIXMAP_SCALE_SIZE = 320;   //must be > THRESHOLD_WINDOW_SIZE
+	PIXMAP_SCALE_FLEX_PERCENT = 5; //a bigger grid costs more thresholding than the rescale
 	PIXMAP_NATIVE_SCALE = false;
 	PIXMAP_FAST_SCALE = true;  //not effective when PIXMAP_NATIVE_SCALE == true
 
 	JPG_SCALE = true;
+	JPG_RAW_LUMA = true;
 
 	ANCHOR_BOX_FLEX_PERCENT = 30;
 	SHAPE_BOX_FLEX_PERCENT = 30;
+	PATTERN_CONFIDENCE_FLOOR = 0; //off, 1 and up drop unsure orientations (unmatched blocks always)
 
 	GRID_WIDTH = 0;
 	GRID_HEIGHT = 0;
+	IMAGE_ORIENTATION = 1;
 
 	PESSIMISTIC_ROTATION = true;
 
 	DBGPIXMAP = NULL;
+	STATS = new Stats();
+	MEMORY_STATS = false;
 
 	PIXBUF = NULL;
 	EDGE_MAP = NULL;
+	pixbuf_size = 0;
+	edgemap_size = 0;
 
 	TAG_IMAGE_FILE = "";
+	TAG_IMAGE_MMAP = true;
+	TAG_IMAGE_DATA = NULL;
+	TAG_IMAGE_DATA_SIZE = 0;
+
+	STREAM_TRACKING = true;
+	STREAM_WINDOW_ANCHORS = 3; //the code ends about 1.9 anchor widths from the anchor center, the rest is motion
+	STREAM_DEBOUNCE_FRAMES = 5;
+	TAGS_PER_SIDE = 3;
+	MULTIPLE_TAGS = false;
 
 	DEBUG         = false;
 	VISUAL_DEBUG  = false;
@@ -47,6 +88,7 @@ Config::Config()
 Config::~Config()
 {
 	if(DBGPIXMAP != NULL) delete DBGPIXMAP;
+	if(STATS != NULL) delete STATS;
 	if(PIXBUF != NULL) delete [] PIXBUF;
 	if(EDGE_MAP != NULL) delete [] EDGE_MAP;
 }
@@ -57,6 +99,7 @@ Config::freePixbuf() //free from border
 	if(PIXBUF != NULL) { 
 		delete [] PIXBUF;
 		PIXBUF = NULL;
+		trackFree(pixbuf_size);
 	}
 }
 
@@ -66,9 +109,50 @@ Config::freeEdgemap() //free from border
 	if(EDGE_MAP != NULL) { 
 		delete [] EDGE_MAP;
 		EDGE_MAP = NULL;
+		trackFree(edgemap_size * sizeof(bool));
 	}
 }
 
+void
+Config::adoptEdgemap(bool *map, int size)
+{
+	freeEdgemap();
+	EDGE_MAP = map;
+	edgemap_size = size;
+}
+
+unsigned char*
+Config::newPixbuf(int size)
+{
+	freePixbuf();
+	PIXBUF = new unsigned char[size];
+	pixbuf_size = size;
+	trackAlloc(size);
+	return PIXBUF;
+}
+
+bool*
+Config::newEdgemap(int size)
+{
+	freeEdgemap();
+	EDGE_MAP = new bool[size];
+	edgemap_size = size;
+	trackAlloc(size * sizeof(bool));
+	return EDGE_MAP;
+}
+
+void
+Config::trackAlloc(long long bytes)
+{
+	if(MEMORY_STATS) STATS->memAlloc(bytes);
+}
+
+void
+Config::trackFree(long long bytes)
+{
+	if(MEMORY_STATS) STATS->memFree(bytes);
+}
+
 
 bool
 Config::CHECK_VISUAL_DEBUG()
@@ -89,16 +173,21 @@ Config::checkArgs(int argc, char **argv)
 	if( argc < 2 ) {
 		cerr << endl;
 		cerr << "Usage:" << endl;
-		cerr << "\t" << argv[0] << " imagefile.jpg [thread count] [l|v|d|t] [threshold]" << endl ;
-		cerr << "\t\t\t[scaletype] [scalesize] [windowsize]" << endl;
+		cerr << "\t" << argv[0] << " imagefile.jpg [thread count] [l|v|d|t|m] [threshold]" << endl ;
+		cerr << "\t\t\t[scaletype] [scalesize] [windowsize] [profile]" << endl;
+		cerr << "\t" << argv[0] << " -s socketfile [worker count] [l|v|d|t|m] [threshold]" << endl ;
+		cerr << "\t\t\t[scaletype] [scalesize] [windowsize] [profile]" << endl;
 		cerr << endl;
 		cerr << "\tl: debug log" << endl ;
 		cerr << "\tv: visual debug" << endl;
 		cerr << "\td: debug log and visual debug" << endl;
 		cerr << "\tt: performance data" << endl;
+		cerr << "\tm: performance data and memory accounting" << endl;
 		cerr << "\tscaletype: 1 = slower more accurate" << endl;
 		cerr << "\tscaletype: 2 = native image lib scale" << endl;
 		cerr << "\tscaletype: Default is fast scale" << endl;
+		cerr << "\tprofile: tuned options file (throughput tune), overrides the ones before it" << endl;
+		cerr << "\t-s: serve length prefixed jpeg requests on a unix socket" << endl;
 		cerr << endl;
 		return false;
 	}
@@ -116,6 +205,9 @@ Config::checkArgs(int argc, char **argv)
 			VISUAL_DEBUG = true;
 			cout << "Visual Debug enabled" << endl ;
 		}
+		if( option == string("m") ){
+			MEMORY_STATS = true;
+		}
 		if( option == string("a") ){
 			ANCHOR_DEBUG = true;
 			cout << "Anchor Debug enabled" << endl ;
@@ -134,6 +226,7 @@ Config::checkArgs(int argc, char **argv)
 	if(argc >= 8) { if(atoi(argv[7]) > 0) THRESHOLD_WINDOW_SIZE = atoi(argv[7]); }
 	if(type == 2) PIXMAP_NATIVE_SCALE = true;
 	if(type == 1) PIXMAP_FAST_SCALE   = false;
+	if(argc >= 9 && ! readProfile(argv[8])) return false;
 
 	ARGS_OK = true;
 
@@ -141,4 +234,75 @@ Config::checkArgs(int argc, char **argv)
 
 }
 
+/* 
+* copy the tunable options only, not the per image state 
+* (buffers, grid size, image source)
+*/
+void
+Config::copyOptions(Config *from)
+{
+	THREADS                   = from->THREADS;
+	THRESHOLD_WINDOW_SIZE     = from->THRESHOLD_WINDOW_SIZE;
+	THRESHOLD_OFFSET          = from->THRESHOLD_OFFSET;
+	THRESHOLD_RGB_FACTOR      = from->THRESHOLD_RGB_FACTOR;
+	THRESHOLD_RETRIES         = from->THRESHOLD_RETRIES;
+	for(int i = 0; i < MAX_THRESHOLD_RETRIES; i++) THRESHOLD_RETRY_OFFSETS[i] = from->THRESHOLD_RETRY_OFFSETS[i];
+	PIXMAP_SCALE_SIZE         = from->PIXMAP_SCALE_SIZE;
+	PIXMAP_SCALE_FLEX_PERCENT = from->PIXMAP_SCALE_FLEX_PERCENT;
+	PIXMAP_FAST_SCALE         = from->PIXMAP_FAST_SCALE;
+	PIXMAP_NATIVE_SCALE       = from->PIXMAP_NATIVE_SCALE;
+	JPG_SCALE                 = from->JPG_SCALE;
+	JPG_RAW_LUMA              = from->JPG_RAW_LUMA;
+	TAG_IMAGE_MMAP            = from->TAG_IMAGE_MMAP;
+	STREAM_TRACKING           = from->STREAM_TRACKING;
+	STREAM_WINDOW_ANCHORS     = from->STREAM_WINDOW_ANCHORS;
+	STREAM_DEBOUNCE_FRAMES    = from->STREAM_DEBOUNCE_FRAMES;
+	TAGS_PER_SIDE             = from->TAGS_PER_SIDE;
+	ANCHOR_BOX_FLEX_PERCENT   = from->ANCHOR_BOX_FLEX_PERCENT;
+	SHAPE_BOX_FLEX_PERCENT    = from->SHAPE_BOX_FLEX_PERCENT;
+	PATTERN_CONFIDENCE_FLOOR  = from->PATTERN_CONFIDENCE_FLOOR;
+	PESSIMISTIC_ROTATION      = from->PESSIMISTIC_ROTATION;
+	MEMORY_STATS              = from->MEMORY_STATS;
+	DEBUG                     = from->DEBUG;
+	ANCHOR_DEBUG              = from->ANCHOR_DEBUG;
+	ARGS_OK                   = from->ARGS_OK;
+}
+
+/* 
+* a profile is one "NAME value" line per option, # starts a comment 
+* options missing from it are left as they are 
+*/
+bool
+Config::readProfile(string filename)
+{
+	ifstream file(filename.c_str());
+	if( ! file ){
+		cerr << "can't open profile " << filename << endl;
+		return false;
+	}
+	string line;
+	int number = 0;
+	while( getline(file, line) ){
+		number++;
+		size_t hash = line.find('#');
+		if( hash != string::npos ) line.erase(hash);
+		istringstream fields(line);
+		string name;
+		int value = 0;
+		if( ! (fields >> name) ) continue;
+		int i = 0;
+		while( i < PROFILE_OPTIONS && name != profile_options[i].name ) i++;
+		if( i == PROFILE_OPTIONS || ! (fields >> value) ){
+			cerr << filename << ":" << number << ": bad profile line" << endl;
+			return false;
+		}
+		this->*profile_options[i].option = value;
+	}
+	return true;
+}
 
+void
+Config::writeProfile(ostream &out)
+{
+	for(int i = 0; i < PROFILE_OPTIONS; i++) out << profile_options[i].name << " " << this->*profile_options[i].option << endl;
+}
@@ -5,6 +5,7 @@
 
 #include "common.h"
 #include "pixmap.h"
+#include "stats.h"
 
 class Config
 {
@@ -19,32 +20,58 @@ public:
 	int THRESHOLD_WINDOW_SIZE; 	//Adapative thresholdng window size(lower the faster)
 	int THRESHOLD_OFFSET;		//threshold offset adjustment
 	int THRESHOLD_RGB_FACTOR;	//RGB range multiplication factor 
+	int THRESHOLD_RETRIES;		//offsets of THRESHOLD_RETRY_OFFSETS tried when processTag() finds none (0 = off)
+	int THRESHOLD_RETRY_OFFSETS[4];	//in order, edge maps from the window means of the first pass
+					//  (THREADS of them at a time, each on its own thread)
 
 	int  PIXMAP_SCALE_SIZE;         //fix pixmap to this bounding box size 
 	int  PIXMAP_MINIMUM_SCALE_SIZE; //minimum valid value for PIXMAP_SCALE_FACTOR
 	bool PIXMAP_FAST_SCALE;         //scale by skipping(FAST) or by averaging(SLOW)
 	bool PIXMAP_NATIVE_SCALE;  //scale using platform specific external libraray
-	bool JPG_SCALE;			   //scale by 2/4/8 on IJG JPEG lib decompress 
+	int  PIXMAP_SCALE_FLEX_PERCENT; //no rescale when up to this percent over PIXMAP_SCALE_SIZE
+	bool JPG_SCALE;			   //scale by M/8 on IJG JPEG lib decompress 
+	bool JPG_RAW_LUMA;		   //decode only the Y plane of YCbCr JPEGs (raw_data_out)
 	//NATIVE_SCALE requires no further scaling, JPG_SCALE may need further scaling
 
 	int ANCHOR_BOX_FLEX_PERCENT;    //allowed flexibility for box width and height 
 	int SHAPE_BOX_FLEX_PERCENT;	//allowed flexibility for box width and height
+	int PATTERN_CONFIDENCE_FLOOR;	//least Shape::getConfidence() of a block before Pattern drops the orientation
 
 	int GRID_WIDTH;			//image width
 	int GRID_HEIGHT;		//image height
+	int IMAGE_ORIENTATION;		//EXIF 1..8 of the current image (1 upright), set by Tagimage for files,
+					//by the caller for camera frames (sensor rotation), hints Pattern::locateAnchor
 
 	bool PESSIMISTIC_ROTATION;	//resizing the grid for rotated shapes
 
 	string TAG_IMAGE_FILE; 		//image filename 
+	unsigned char *TAG_IMAGE_DATA;	//in memory image, used instead of TAG_IMAGE_FILE (not owned)
+	int  TAG_IMAGE_DATA_SIZE;	//in memory image size in bytes
+	bool TAG_IMAGE_MMAP;		//read TAG_IMAGE_FILE through a shared memory mapping (Mappedfile)
+	bool STREAM_TRACKING;		//Decoder::processFrame() searches around the last tag first
+	int  STREAM_WINDOW_ANCHORS;	//tracking window half size, in anchor widths around the last anchor
+	int  STREAM_DEBOUNCE_FRAMES;	//frames without the tag before the same tag is reported new again
+	int  TAGS_PER_SIDE;		//Decoder::processTags(): tags across the longer side, lowers the shape size limits
+	bool MULTIPLE_TAGS;		//processTags() pass running (set by Decoder)
 	Pixmap* DBGPIXMAP;
+	Stats*  STATS;			//per stage timings and counts of the last decode
+	bool MEMORY_STATS;		//account the big buffers in STATS (off by default)
 
-	int THREADS;
+	int THREADS;			//Threshold threads: the first edge map splits in two at 2 only, retries use up to THREADS
 
 	bool CHECK_VISUAL_DEBUG();
 	void setDebugPixmap(Pixmap* pixmap);
 	bool checkArgs(int argc, char **argv);
+	void copyOptions(Config *config);
+	bool readProfile(string filename);	//"NAME value" lines of the tuned options (throughput tune)
+	void writeProfile(ostream &out);
 	void freeEdgemap();
+	void adoptEdgemap(bool *map, int size);	//EDGE_MAP is map now, allocated (and tracked) by the caller
 	void freePixbuf();
+	unsigned char* newPixbuf(int size);
+	bool* newEdgemap(int size);
+	void trackAlloc(long long bytes);	//no op unless MEMORY_STATS
+	void trackFree(long long bytes);
 
 	bool DEBUG;
 	bool VISUAL_DEBUG;
@@ -54,11 +81,18 @@ public:
 
 	static const int MAX_ANCHORS;
 	static const int MAX_SHAPES;
+	static const int MAX_TAGS;	//Decoder::processTags() stops at this many
+	static const int MAX_IMAGE_PIXELS;	//larger decoded images are rejected (Probe, Pngreader, Pnmreader)
+	static const int MAX_THRESHOLD_RETRIES = 4; //size of THRESHOLD_RETRY_OFFSETS
 	static const bool PLATFORM_CPP;
 	static const bool PLATFORM_CPP_MAGICK;
 	static const bool PLATFORM_CPP_SYMBIAN;
 	static const bool PLATFORM_CPP_SYMBIAN_S60;
 
+private:
+	int pixbuf_size;
+	int edgemap_size;
+
 	/*
 	static final boolean PLATFORM_JAVA = true;
 	static final boolean PLATFORM_JAVA_ME = false;
@@ -20,6 +20,18 @@ Decoder::Decoder(Tagimage* _tagimage)
 	if(tagimage != NULL) config->ARGS_OK = true;
 }
 
+Decoder::Decoder(unsigned char *_data, int _size)
+{
+	init();
+	setImage(_data, _size);
+}
+
+Decoder::Decoder(unsigned char *_luma, int _width, int _height, int _stride)
+{
+	init();
+	setFrame(_luma, _width, _height, _stride);
+}
+
 Decoder::~Decoder()
 {
 	if(tagimage != NULL) delete tagimage;
@@ -31,6 +43,19 @@ Decoder::init()
 {
 	tagimage = NULL;
 	for(int i=0; i<12; i++) tag[i] = -1;
+	confidence = 0;
+	cancelled = false;
+	stopped   = false;
+	deadline  = 0;
+	found_x = found_y = found_w = found_h = 0;
+	found_anchor_at = found_tilt = 0;
+	found_scale = track_scale = 1;
+	hint_anchor_at = hint_tilt = 0;
+	track_x = track_y = track_w = track_h = 0;
+	track_anchor_at = track_tilt = 0;
+	for(int i=0; i<12; i++) last_tag[i] = -1;
+	missed_frames = 0;
+	new_tag = false;
 	config = (Config*) new Config();
 }
 
@@ -46,32 +71,434 @@ Decoder::copyTag(int* _tag)
 	for(int i=0; i<12; i++) _tag[i] = tag[i];
 }
 
+void
+Decoder::copyTagBox(int* box)
+{
+	box[0] = found_x;
+	box[1] = found_y;
+	box[2] = found_w;
+	box[3] = found_h;
+}
+
+int
+Decoder::getTagCount()
+{
+	return (int)tag_list.size() / 12;
+}
+
+void
+Decoder::copyTag(int index, int* _tag)
+{
+	for(int i=0; i<12; i++) _tag[i] = tag_list[(index * 12) + i];
+}
+
+void
+Decoder::copyTagBox(int index, int* box)
+{
+	for(int i=0; i<4; i++) box[i] = box_list[(index * 4) + i];
+}
+
+int
+Decoder::getConfidence()
+{
+	return confidence;
+}
+
+int
+Decoder::getConfidence(int index)
+{
+	return confidence_list[index];
+}
+
+void
+Decoder::copyStats(Stats* _stats)
+{
+	*_stats = *config->STATS;
+}
+
+void
+Decoder::setImage(unsigned char *_data, int _size)
+{
+	if(tagimage != NULL) { delete tagimage; tagimage = NULL; }
+	for(int i=0; i<12; i++) tag[i] = -1;
+	tag_list.clear();
+	box_list.clear();
+	confidence_list.clear();
+	confidence = 0;
+	cancelled = false;
+	stopped   = false;
+	deadline  = 0;
+	config->TAG_IMAGE_DATA = _data;
+	config->TAG_IMAGE_DATA_SIZE = _size;
+	config->ARGS_OK = (_data != NULL && _size > 0);
+}
+
+void
+Decoder::setFrame(unsigned char *_luma, int _width, int _height, int _stride)
+{
+	setImage(NULL, 0);
+	tagimage = new Tagimage(config, _luma, _width, _height, _stride);
+	config->ARGS_OK = tagimage->isValid();
+}
+
+/* 
+* stream mode: the window of STREAM_WINDOW_ANCHORS anchor widths around 
+* the last anchor is searched first, with its corner and tilt as hints to 
+* Pattern, the whole frame only after a miss there (or with no tag seen) 
+* the window is a stride view into the frame, nothing is copied 
+*
+* cancel() and the deadline apply to the frame as in processTag(), 
+* set the deadline again for every frame 
+*/
+bool
+Decoder::processFrame(unsigned char *luma, int width, int height, int stride)
+{
+	cancelled = false;
+	stopped   = false;
+	bool found = false, tracked = false;
+	if( config->STREAM_TRACKING && track_w > 0 ){
+		int half = (track_w > track_h ? track_w : track_h) * config->STREAM_WINDOW_ANCHORS;
+		int x1 = (track_x + (track_w / 2)) - half, y1 = (track_y + (track_h / 2)) - half;
+		int x2 = x1 + (2 * half), y2 = y1 + (2 * half);
+		if( x1 < 0 ) x1 = 0;
+		if( y1 < 0 ) y1 = 0;
+		if( x2 > width )  x2 = width;
+		if( y2 > height ) y2 = height;
+		//a window clipped at the frame edge may be too thin for the threshold window once scaled
+		int shorter = (x2 - x1) < (y2 - y1) ? (x2 - x1) : (y2 - y1);
+		if( x2 > x1 && y2 > y1 && (x2 - x1) * (y2 - y1) < width * height 
+			&& (float)shorter / track_scale > config->THRESHOLD_WINDOW_SIZE ){
+			//same grid resolution as the last hit, so the smaller window is less work
+			int scale_size = config->PIXMAP_SCALE_SIZE;
+			int longer = (x2 - x1) > (y2 - y1) ? (x2 - x1) : (y2 - y1);
+			config->PIXMAP_SCALE_SIZE = (int)(((float)longer / track_scale) + 0.5);
+			wrapFrame(luma + (y1 * stride) + x1, x2 - x1, y2 - y1, stride);
+			hint_anchor_at = track_anchor_at;
+			hint_tilt      = track_tilt;
+			found   = processTag() && hasTag();
+			config->PIXMAP_SCALE_SIZE = scale_size;
+			//a code other than the tracked one may be a misread of the window, 
+			//there is no checksum, so the whole frame has the final say
+			for(int i=0; i<12 && found; i++) found = tag[i] == last_tag[i];
+			tracked = found;
+			if( found ){ found_x += x1; found_y += y1; }
+		}
+	}
+	if( ! found && ! stopped ){ //lost in the window, or nothing to track
+		hint_anchor_at = 0;
+		hint_tilt      = 0;
+		wrapFrame(luma, width, height, stride);
+		found = processTag() && hasTag();
+	}
+	hint_anchor_at = 0;
+	hint_tilt      = 0;
+
+	if( found ){
+		track_x = found_x; track_y = found_y; track_w = found_w; track_h = found_h;
+		track_anchor_at = found_anchor_at;
+		track_tilt      = found_tilt;
+		if( ! tracked ) track_scale = found_scale; //from the whole frame, windows would drift
+	}else{
+		track_w = track_h = 0;
+	}
+
+	//debounce, the same tag again is new only after it was gone for a while
+	new_tag = false;
+	if( found ){
+		bool same = missed_frames < config->STREAM_DEBOUNCE_FRAMES;
+		for(int i=0; i<12 && same; i++) same = tag[i] == last_tag[i];
+		if( ! same ){
+			for(int i=0; i<12; i++) last_tag[i] = tag[i];
+			new_tag = true;
+		}
+		missed_frames = 0;
+	}else if( ! stopped ){
+		missed_frames++;
+	}
+	config->STATS->tracked = tracked ? 1 : 0;
+	return found;
+}
+
+bool
+Decoder::isNewTag()
+{
+	return new_tag;
+}
+
+//the frame (or a window of it) as the next image, keeping the deadline
+void
+Decoder::wrapFrame(unsigned char *luma, int width, int height, int stride)
+{
+	if(tagimage != NULL) delete tagimage;
+	for(int i=0; i<12; i++) tag[i] = -1;
+	config->TAG_IMAGE_DATA = NULL;
+	config->TAG_IMAGE_DATA_SIZE = 0;
+	tagimage = new Tagimage(config, luma, width, height, stride);
+	config->ARGS_OK = tagimage->isValid();
+}
+
+bool
+Decoder::hasTag()
+{
+	for(int i=0; i<12; i++) if( tag[i] < 0 ) return false;
+	return true;
+}
+
+void
+Decoder::setDeadline(long long _deadline)
+{
+	deadline = _deadline;
+}
+
+void
+Decoder::cancel()
+{
+	cancelled = true;
+}
+
+bool
+Decoder::isStopped()
+{
+	return stopped;
+}
+
+bool
+Decoder::checkStop()
+{
+	if( cancelled ) stopped = true;
+	else if( deadline > 0 && Timer::nowMillis() >= deadline ) stopped = true;
+	return stopped;
+}
+
 bool
 Decoder::processTag()
 {
+	return decode(false);
+}
+
+/* 
+* one Threshold and Border pass for all the tags: Border keeps every anchor 
+* candidate, and the Pattern search runs around each (biggest first) on 
+* copies of the shapes near it, as the tilt correction rotates them 
+* the same code found again next to an earlier one is the same tag 
+*/
+bool
+Decoder::processTags()
+{
+	return decode(true);
+}
+
+/* 
+* cancel() and the deadline are checked between the stages only 
+* (before decoding, after Threshold, after Border) 
+* a stopped decode returns false and leaves the tag unset 
+*/
+bool
+Decoder::decode(bool multiple)
+{
+	Stats *stats = config->STATS;
+	stats->reset();
+	tag_list.clear();
+	box_list.clear();
+	confidence_list.clear();
+	confidence = 0;
 	if(!config->ARGS_OK ) return false;
+	if(checkStop()) return false;
+	long long start = Timer::now(), mark = start;
 	if(tagimage == NULL) tagimage = new Tagimage(config);
+	stats->jpeg_decode = Timer::now() - mark;
 	if(!tagimage->isValid()) { 
 		delete tagimage; tagimage = NULL;
 		return false;
 	}
+	int image_width  = tagimage->getWidth();
+	int image_height = tagimage->getHeight();
+#ifndef PRODUCTION
 	if(config->VISUAL_DEBUG) config->setDebugPixmap(new Pixmap(config->TAG_IMAGE_FILE));
+#endif
+	mark = Timer::now();
+	stats->memStage(MEM_THRESHOLD);
 	Threshold* threshold = new Threshold(config, tagimage);
+	stats->scaling = Timer::now() - mark;
+	//the grid the image scales to needs both sides longer than the window (thin strips do not)
+	if( config->GRID_WIDTH <= config->THRESHOLD_WINDOW_SIZE || config->GRID_HEIGHT <= config->THRESHOLD_WINDOW_SIZE ){
+		delete threshold;
+		delete tagimage; tagimage = NULL;
+		config->freeEdgemap();
+		return false;
+	}
+	//retries need the image and the window means after the first pass
+	bool retry = ! multiple && config->THRESHOLD_RETRIES > 0;
+	if( retry ) threshold->keepMeans();
 	threshold->computeEdgemap();
-	delete tagimage; tagimage = NULL;
-	delete threshold;
-	Shape *shapes = new Shape[config->MAX_SHAPES];
+	int grid_w = config->GRID_WIDTH, grid_h = config->GRID_HEIGHT;
+	if( ! retry ){
+		delete tagimage; tagimage = NULL;
+		delete threshold; threshold = NULL;
+	}
+	if(checkStop()) { 
+		config->freeEdgemap();
+	}else{
+		traceTags(multiple, image_width, image_height);
+		if( retry ) retryThreshold(threshold, grid_w, grid_h, image_width, image_height);
+	}
+	if( retry ){
+		delete tagimage; tagimage = NULL;
+		delete threshold;
+	}
+	config->MULTIPLE_TAGS = false;
+	stats->total = Timer::now() - start;
+	return !stopped;
+}
+
+/* 
+* Border and Pattern on the EDGE_MAP of the grid Threshold left 
+* (Border frees the edge map) 
+*/
+void
+Decoder::traceTags(bool multiple, int image_width, int image_height)
+{
+	Stats *stats = config->STATS;
+	stats->memStage(MEM_BORDER);
+	int max_shapes = multiple ? config->MAX_SHAPES * config->MAX_TAGS : config->MAX_SHAPES;
+	Shape *shapes = new Shape[max_shapes];
 	Shape *anchor = new Shape(config);
+	Shape *candidates = NULL;
+	int ncandidates = 0;
 	Border* border = new Border(config, shapes, anchor);
+	config->MULTIPLE_TAGS = multiple;
+	if( multiple ) border->collectAnchors(max_shapes);
 	int nshapes = border->findShapes();
+	if( multiple && nshapes >= 12 ){
+		candidates  = new Shape[config->MAX_TAGS * 2];
+		ncandidates = border->copyAnchors(candidates, config->MAX_TAGS * 2);
+	}
 	delete border;
-	if( nshapes >= 12  ){
+	if(checkStop()) nshapes = 0;
+	stats->memStage(MEM_PATTERN);
+	float sx = (float)image_width  / (float)config->GRID_WIDTH;
+	float sy = (float)image_height / (float)config->GRID_HEIGHT;
+	if( multiple ){
+		if( nshapes >= 12 ) findTags(shapes, nshapes, candidates, ncandidates, sx, sy);
+	}else if( nshapes >= 12  ){
+		//anchor box back in image pixels, before Pattern rotates it and the grid
+		found_scale = sx > sy ? sx : sy;
+		found_x = (int)((float)anchor->getminx() * sx);
+		found_y = (int)((float)anchor->getminy() * sy);
+		found_w = (int)((float)(anchor->getmaxx() - anchor->getminx()) * sx);
+		found_h = (int)((float)(anchor->getmaxy() - anchor->getminy()) * sy);
 		Pattern* pattern = new Pattern(config, shapes, nshapes, anchor);
+		pattern->setHint(hint_anchor_at, hint_tilt);
 		pattern->findCode(tag);
+		found_anchor_at = pattern->getAnchorAt();
+		found_tilt      = pattern->getTilt();
+		if( hasTag() ) confidence = pattern->getConfidence();
 		delete pattern;
 	}
+	if( candidates != NULL ) delete [] candidates;
 	delete anchor;
 	delete [] shapes;
-	return true;
 }
 
+/* 
+* No tag at THRESHOLD_OFFSET: edge maps for THRESHOLD_RETRY_OFFSETS from the 
+* window means the first pass kept, THREADS of them at a time (made in parallel), 
+* traced in order until one decodes, instead of a whole new decode per offset 
+* Pattern may resize the grid for rotated shapes, it is put back each time 
+*/
+void
+Decoder::retryThreshold(Threshold *threshold, int grid_w, int grid_h, int image_width, int image_height)
+{
+	Stats *stats = config->STATS;
+	int n = config->THRESHOLD_RETRIES;
+	if( n > Config::MAX_THRESHOLD_RETRIES ) n = Config::MAX_THRESHOLD_RETRIES;
+	int batch = config->THREADS > 1 ? config->THREADS : 1;
+	int size = grid_w * grid_h;
+	bool *maps[Config::MAX_THRESHOLD_RETRIES];
+	for(int i = 0; i < n && ! hasTag() && ! checkStop(); i += batch){
+		int count = n - i < batch ? n - i : batch;
+		stats->memStage(MEM_THRESHOLD);
+		long long mark = Timer::now();
+		for(int k = 0; k < count; k++){
+			maps[k] = new bool[size];
+			config->trackAlloc(size * sizeof(bool));
+		}
+		threshold->retryEdgemaps(&config->THRESHOLD_RETRY_OFFSETS[i], count, maps);
+		stats->retry += Timer::now() - mark;
+		for(int k = 0; k < count; k++){
+			if( hasTag() || checkStop() ){ //found with an earlier one of the batch
+				delete [] maps[k];
+				config->trackFree(size * sizeof(bool));
+				continue;
+			}
+			config->GRID_WIDTH  = grid_w;
+			config->GRID_HEIGHT = grid_h;
+			config->adoptEdgemap(maps[k], size);
+			stats->threshold_retries++;
+			traceTags(false, image_width, image_height);
+		}
+	}
+}
+
+/* 
+* Pattern for each anchor candidate on copies of the shapes within reach 
+* of it and no bigger than it, the code ends about 1.9 anchor widths from 
+* the anchor center 
+* Pattern may resize the grid for rotated shapes, it is put back each time 
+*/
+void
+Decoder::findTags(Shape *shapes, int nshapes, Shape *candidates, int ncandidates, float sx, float sy)
+{
+	int grid_w = config->GRID_WIDTH, grid_h = config->GRID_HEIGHT;
+	Shape *near = new Shape[config->MAX_SHAPES];
+	for(int c = 0; c < ncandidates && getTagCount() < config->MAX_TAGS; c++){
+		Shape *a = &candidates[c];
+		int cx = a->getcx(), cy = a->getcy();
+		int size  = a->getWidth() > a->getHeight() ? a->getWidth() : a->getHeight();
+		int reach = (size * 5) / 2;
+		int n = 0;
+		for(int i = 0; i < nshapes && n < config->MAX_SHAPES; i++){
+			if( abs(shapes[i].getcx() - cx) > reach || abs(shapes[i].getcy() - cy) > reach ) continue;
+			//card edges and other tags' outlines, no code block is bigger than its anchor
+			if( shapes[i].getWidth() > size || shapes[i].getHeight() > size ) continue;
+			near[n].setConfig(config);
+			near[n++].copyShape(&shapes[i]);
+		}
+		if( n < 12 ) continue;
+
+		int box[4];
+		box[0] = (int)((float)a->getminx() * sx);
+		box[1] = (int)((float)a->getminy() * sy);
+		box[2] = (int)((float)a->getWidth() * sx);
+		box[3] = (int)((float)a->getHeight() * sy);
+		int found[12];
+		for(int i = 0; i < 12; i++) found[i] = -1;
+		config->GRID_WIDTH  = grid_w;
+		config->GRID_HEIGHT = grid_h;
+		Pattern* pattern = new Pattern(config, near, n, a);
+		pattern->findCode(found);
+		int sure = pattern->getConfidence();
+		delete pattern;
+		bool valid = true;
+		for(int i = 0; i < 12; i++) if( found[i] < 0 ) valid = false;
+		if( ! valid ) continue;
+
+		//the same code again from a candidate within reach of an earlier one
+		bool seen = false;
+		for(int t = 0; t < getTagCount() && ! seen; t++){
+			int *b = &box_list[t * 4];
+			int dx = abs((b[0] + (b[2] / 2)) - (box[0] + (box[2] / 2)));
+			int dy = abs((b[1] + (b[3] / 2)) - (box[1] + (box[3] / 2)));
+			int far = ((b[2] > b[3] ? b[2] : b[3]) * 5) / 2;
+			seen = dx < far && dy < far;
+			for(int i = 0; i < 12 && seen; i++) seen = tag_list[(t * 12) + i] == found[i];
+		}
+		if( seen ) continue;
+		for(int i = 0; i < 12; i++) tag_list.push_back(found[i]);
+		for(int i = 0; i < 4; i++)  box_list.push_back(box[i]);
+		confidence_list.push_back(sure);
+	}
+	config->GRID_WIDTH  = grid_w;
+	config->GRID_HEIGHT = grid_h;
+	delete [] near;
+}
@@ -2,12 +2,14 @@
 #define _DECODER_H_INCLUDED
 
 #include <string>
+#include <vector>
 
 #include "threshold.h"
 #include "tagimage.h"
 #include "pixmap.h"
 #include "border.h"
 #include "pattern.h"
+#include "timer.h"
 #include "common.h"
 
 
@@ -20,6 +22,8 @@ public:
 	Decoder(string filename); 		//Give me the image file name
 	Decoder(int argc, char **argv); //Or give me the image file and other command line options
 	Decoder(Tagimage* tagimage);	//Or give the image object you have created already 
+	Decoder(unsigned char *data, int size); //Or give me the jpeg image already in memory (I dont copy or free it)
+	Decoder(unsigned char *luma, int width, int height, int stride); //Or a camera frame, 8 bit grey or the NV12/YUV420 Y plane (I dont copy or free it)
 	~Decoder();						//  **BE WARNED** To save memory I am told to delete the image 
 									//  as soon I finish processing, so pass me a copy of you want to keep it. 
 									//  *DONT DELETE** the image agian yourself afterwards
@@ -28,13 +32,56 @@ public:
 	Config* getConfig();			//Get my configuration control, and customize my behaviour
 	bool    processTag();			//Ask me to proces it for you (I assign all my work to others here)
 	void    copyTag(int *tag);		//Copy (not a reference) the result back to you
+	int     getConfidence();		//How sure I am of it, 0..100 (the least certain of its 12 blocks)
+	void    copyTagBox(int *box);		//And where it is, the anchor x, y, width, height in image pixels
+									//  (frame pixels for processFrame), only valid when I found a tag
+	bool    processTags();			//Or find every tag in the image (shelf and poster photos), still one pass
+	int     getTagCount();			//How many tags processTags() found
+	void    copyTag(int index, int *tag);	//Copy one of them back to you
+	void    copyTagBox(int index, int *box); //And where it is, the anchor x, y, width, height in image pixels
+	int     getConfidence(int index);	//And how sure I am of it
+	void    copyStats(Stats *stats);	//Copy how long each of my stages took for the last image
+	void    setImage(unsigned char *data, int size); //Reuse me with my options for the next in memory image
+	void    setFrame(unsigned char *luma, int width, int height, int stride); //Or for the next camera frame
+	bool    processFrame(unsigned char *luma, int width, int height, int stride); //Or stream me camera frames, I track 
+									//  the tag from frame to frame and return true when this frame has one
+	bool    isNewTag();				//Was the tag of the last processFrame() not the one I reported just before
+	void    setDeadline(long long deadline); //Give up after this Timer::nowMillis() time (0 = never)
+	void    cancel();				//Ask me to give up at the next stage (safe from another thread)
+	bool    isStopped();			//Did I give up, either cancelled or past the deadline
 
 private:							//These are my internal stuff, not of interest to outside world
 	void init();
+	bool checkStop();
+	bool decode(bool multiple);
+	void traceTags(bool multiple, int image_width, int image_height);
+	void retryThreshold(Threshold *threshold, int grid_w, int grid_h, int image_width, int image_height);
+	void findTags(Shape *shapes, int nshapes, Shape *candidates, int ncandidates, float sx, float sy);
+	bool hasTag();
+	void wrapFrame(unsigned char *luma, int width, int height, int stride);
 
 	Config*   config;		//Where I store all my options (ask the Config class for details)
 	Tagimage* tagimage;		//The image I am working on(either a reference or one I created)
 	int tag[12];			//I store the result here
+	vector<int> tag_list;		//Or the processTags() results here, 12 per tag
+	vector<int> box_list;		//And their anchor boxes, 4 per tag
+	int confidence;			//Pattern::getConfidence() of the tag
+	vector<int> confidence_list;
+	volatile bool cancelled;	//Set from outside, checked between my stages
+	long long deadline;		//Timer::nowMillis() time to give up at, 0 is no deadline
+	bool stopped;			//I gave up on the last image
+
+	//stream mode (processFrame), boxes in frame pixels
+	int  found_x, found_y, found_w, found_h; //anchor of the last processTag(), in its image
+	int  found_anchor_at, found_tilt;	//orientation of the last tag Pattern decoded
+	float found_scale;			//image pixels per grid pixel
+	int  hint_anchor_at, hint_tilt;		//handed to Pattern, 0 is none
+	int  track_x, track_y, track_w, track_h; //anchor of the tag in the last frame, track_w 0 is lost
+	int  track_anchor_at, track_tilt;
+	float track_scale;
+	int  last_tag[12];		//last tag reported new
+	int  missed_frames;		//frames since the tag was last seen
+	bool new_tag;
 };
 
 #endif /* _DECODER_H_INCLUDED */
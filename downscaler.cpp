@@ -0,0 +1,114 @@
+#include "downscaler.h"
+#include <string.h>
+
+#ifdef DOWNSCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+//first source column/row of each output box, table[n] is the end of the last box
+static int*
+boxTable(int n, int src_n, float scale)
+{
+	int *table = new int[n + 1];
+	for(int i = 0; i <= n; i++){
+		table[i] = (int)((float)i*scale);
+		if( table[i] > src_n ) table[i] = src_n;
+	}
+	return table;
+}
+
+//acc[i] += row[i], 16 at a time with SSE2
+static void
+addRow(unsigned short *acc, unsigned char *row, int n)
+{
+	int i = 0;
+#ifdef DOWNSCALER_SSE2
+	__m128i zero = _mm_setzero_si128();
+	for(; i + 16 <= n; i += 16){
+		__m128i p  = _mm_loadu_si128((__m128i *)(row + i));
+		__m128i *a = (__m128i *)(acc + i);
+		_mm_storeu_si128(a,     _mm_add_epi16(_mm_loadu_si128(a),     _mm_unpacklo_epi8(p, zero)));
+		_mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(p, zero)));
+	}
+#endif
+	for(; i < n; i++) acc[i] += row[i];
+}
+
+static inline unsigned char
+fixedMean(int sum, int recip)
+{
+	int v = ((sum * recip) + 32768) >> 16;
+	return (unsigned char)(v > 255 ? 255 : v);
+}
+
+void
+Downscaler::nearest(unsigned char *src, int src_width, int src_height, int src_stride,
+	unsigned char *dst, int width, int height, float scale)
+{
+	int *xs = boxTable(width, src_width - 1, scale);
+	int *ys = boxTable(height, src_height - 1, scale);
+	for(int y = 0; y < height; y++){
+		unsigned char *row = src + (ys[y] * src_stride);
+		for(int x = 0; x < width; x++) *dst++ = row[xs[x]];
+	}
+	delete [] xs;
+	delete [] ys;
+}
+
+void
+Downscaler::average(unsigned char *src, int src_width, int src_height, int src_stride,
+	unsigned char *dst, int width, int height, float scale)
+{
+	//the 16 bit row sums hold up to 257 rows of 255
+	if( scale <= 1 || scale > 257 ){
+		nearest(src, src_width, src_height, src_stride, dst, width, height, scale);
+		return;
+	}
+	int *xs = boxTable(width, src_width, scale);
+	int *ys = boxTable(height, src_height, scale);
+	int used = xs[width];
+	int w = (int)scale;
+	unsigned short *acc = new unsigned short[used + w + 1]; //zero tail for the last box
+
+	//fixed point 1/area for every box size, boxes are (int)scale or one more wide
+	int maxbox = (int)scale + 1;
+	int *recip = new int[(maxbox * maxbox) + 1];
+	recip[0] = 65536; //clipped at the image end
+	for(int area = 1; area <= maxbox * maxbox; area++) recip[area] = (65536 + (area/2)) / area;
+
+	int k = w;
+	if( (float)k != scale || k > 4 ) k = 0; //not one of the unrolled ratios
+
+	for(int y = 0; y < height; y++){
+		int rows = ys[y+1] - ys[y];
+		memset(acc, 0, (used + w + 1) * sizeof(unsigned short));
+		for(int r = 0; r < rows; r++) addRow(acc, src + ((ys[y] + r) * src_stride), used);
+
+		unsigned short *a = acc;
+		int r = recip[k * rows];
+		switch(k){
+			case 2:
+				for(int x = 0; x < width; x++, a += 2) *dst++ = fixedMean(a[0] + a[1], r);
+				break;
+			case 3:
+				for(int x = 0; x < width; x++, a += 3) *dst++ = fixedMean(a[0] + a[1] + a[2], r);
+				break;
+			case 4:
+				for(int x = 0; x < width; x++, a += 4) *dst++ = fixedMean(a[0] + a[1] + a[2] + a[3], r);
+				break;
+			default: //w or w+1 wide, the extra column added without a branch
+				for(int x = 0; x < width; x++){
+					unsigned short *b = acc + xs[x];
+					int extra = xs[x+1] - xs[x] - w;
+					int sum = 0;
+					for(int i = 0; i < w; i++) sum += b[i];
+					sum += b[w] * extra;
+					*dst++ = fixedMean(sum, recip[(w + extra) * rows]);
+				}
+		}
+	}
+	delete [] acc;
+	delete [] recip;
+	delete [] xs;
+	delete [] ys;
+}
@@ -0,0 +1,30 @@
+#ifndef _DOWNSCALER_H_INCLUDED
+#define _DOWNSCALER_H_INCLUDED
+
+#include "common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DOWNSCALER_SSE2
+#endif
+
+/*
+* 8 bit grey plane downscaling, source rows are src_stride apart
+* output pixel (x,y) covers the source pixels from (int)(x*scale)
+* to (int)((x+1)*scale), same for y
+*
+* nearest() : the top left source pixel of the box (skip sampling)
+* average() : the mean of the whole box, rows summed with SSE2 when
+*             available, divided with a 16 bit fixed point reciprocal,
+*             unrolled for 2x, 3x and 4x, any other ratio (> 1) works
+*/
+class Downscaler
+{
+
+public:
+	static void nearest(unsigned char *src, int src_width, int src_height, int src_stride,
+		unsigned char *dst, int width, int height, float scale);
+	static void average(unsigned char *src, int src_width, int src_height, int src_stride,
+		unsigned char *dst, int width, int height, float scale);
+};
+
+#endif /* _DOWNSCALER_H_INCLUDED */
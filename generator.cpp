@@ -0,0 +1,364 @@
+#include "generator.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define GEN_BACKGROUND 230 //a darker grey surround gets traced as a big square and taken for the anchor
+#define GEN_PAPER      250
+#define GEN_INK        25
+
+Generator::Generator()
+{
+	WIDTH       = 640;
+	HEIGHT      = 480;
+	TAG_PERCENT = 70;
+	ROTATION    = 0;
+	TILT        = 0;
+	BLUR        = 0;
+	NOISE       = 0;
+	CLUTTER     = 0;
+	QUALITY     = 90;
+	CENTER_X    = -1;
+	CENTER_Y    = -1;
+	SEED        = 1;
+
+	buffer    = NULL;
+	card      = NULL;
+	card_size = 0;
+	state     = SEED;
+}
+
+Generator::~Generator()
+{
+	if(buffer != NULL) delete [] buffer;
+	if(card != NULL)   delete [] card;
+}
+
+unsigned char*
+Generator::getBuffer()
+{
+	return buffer;
+}
+
+//own LCG so the same SEED gives the same image on every platform
+int
+Generator::random(int n)
+{
+	state = state * 1103515245 + 12345;
+	if( n <= 0 ) return 0;
+	return (int)((state >> 16) % (unsigned int)n);
+}
+
+void
+Generator::randomCode(int *code)
+{
+	state = SEED;
+	for(int i = 0; i < 12; i++) code[i] = random(10);
+}
+
+bool
+Generator::render(int *code)
+{
+	for(int i = 0; i < 12; i++) if( code[i] < 0 || code[i] > 9 ) return false;
+	int shorter = WIDTH < HEIGHT ? WIDTH : HEIGHT;
+	card_size = (shorter * TAG_PERCENT) / 100;
+	if( card_size < 16 ) return false;
+
+	state = SEED ^ 0x5bd1e995;
+	if(buffer != NULL) delete [] buffer;
+	if(card != NULL)   delete [] card;
+	buffer = new unsigned char[WIDTH * HEIGHT];
+	card   = new unsigned char[card_size * card_size];
+
+	drawCard(code);
+	placeCard();
+	drawClutter();
+	blurImage();
+	addNoise();
+
+	delete [] card;
+	card = NULL;
+	return true;
+}
+
+void
+Generator::fillCard(int x1, int y1, int x2, int y2)
+{
+	if(x1 < 0) x1 = 0;
+	if(y1 < 0) y1 = 0;
+	if(x2 > card_size) x2 = card_size;
+	if(y2 > card_size) y2 = card_size;
+	for(int y = y1; y < y2; y++){
+		for(int x = x1; x < x2; x++) card[(y * card_size) + x] = GEN_INK;
+	}
+}
+
+/*
+* symbols in the s*s box at x,y as read by Shape::matchBars()/matchBox()
+* (widths and mid points at 1/4 from top and bottom)
+*
+* 3: thin centre stem on top, full bottom      2: full top, thin stem below
+* 4: left column with a middle bar             5: right column with a middle bar
+* 6: top left and bottom right quadrants       7: top right and bottom left
+* 8: all but bottom left   9: all but top right   0: all but top left   1: all but bottom right
+* (quadrants overlap slightly so the symbol stays a single shape)
+*/
+void
+Generator::drawDigit(int digit, int x, int y, int s)
+{
+	int h = s / 2, t = s / 6, o = s / 20 + 1;
+	bool tl = false, tr = false, bl = false, br = false;
+	switch (digit){
+		case 2:
+			fillCard(x, y, x + s, y + h);
+			fillCard(x + h - t/2, y + h, x + h + t/2 + 1, y + s);
+			return;
+		case 3:
+			fillCard(x + h - t/2, y, x + h + t/2 + 1, y + h);
+			fillCard(x, y + h, x + s, y + s);
+			return;
+		case 4:
+			fillCard(x, y, x + h, y + s);
+			fillCard(x, y + h - t/2, x + s, y + h + t/2 + 1);
+			return;
+		case 5:
+			fillCard(x + h, y, x + s, y + s);
+			fillCard(x, y + h - t/2, x + s, y + h + t/2 + 1);
+			return;
+		case 6: tl = br = true; break;
+		case 7: tr = bl = true; break;
+		case 8: tl = tr = br = true; break;
+		case 9: tl = bl = br = true; break;
+		case 0: tr = bl = br = true; break;
+		case 1: tl = tr = bl = true; break;
+		default: return;
+	}
+	if(tl) fillCard(x, y, x + h + o, y + h + o);
+	if(tr) fillCard(x + h - o, y, x + s, y + h + o);
+	if(bl) fillCard(x, y + h - o, x + h + o, y + s);
+	if(br) fillCard(x + h - o, y + h - o, x + s, y + s);
+}
+
+/*
+* upright tag on the card, anchor cell top left, then SIDE, BELOW, ACROSS
+* blocks in each group TL, TR, BL, BR (Pattern::idBlock() order) with the
+* code digits placed through the Matrix TL table
+*/
+void
+Generator::drawCard(int *code)
+{
+	static const int TL[12] = { 0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11 };
+	static const int group_x[3] = { 1, 0, 1 };
+	static const int group_y[3] = { 0, 1, 1 };
+	int codeblock[12];
+	for(int i = 0; i < 12; i++) codeblock[TL[i]] = code[i];
+
+	memset(card, GEN_PAPER, card_size * card_size);
+	int size   = (card_size * 8) / 10;
+	int origin = (card_size - size) / 2;
+	int cell   = size / 2;
+	int margin = cell / 10;
+	fillCard(origin + margin, origin + margin, origin + cell - margin, origin + cell - margin);
+
+	int block = cell / 2, gap = block / 6;
+	for(int g = 0; g < 3; g++){
+		for(int b = 0; b < 4; b++){
+			int bx = origin + (group_x[g] * cell) + ((b % 2) * block) + gap;
+			int by = origin + (group_y[g] * cell) + ((b / 2) * block) + gap;
+			drawDigit(codeblock[(g * 4) + b], bx, by, block - (2 * gap));
+		}
+	}
+}
+
+void
+Generator::cardCenter(double *cx, double *cy)
+{
+	*cx = CENTER_X < 0 ? WIDTH / 2.0  : CENTER_X;
+	*cy = CENTER_Y < 0 ? HEIGHT / 2.0 : CENTER_Y;
+}
+
+//the anchor cell of drawCard() through the placeCard() rotation, bounding box of its corners
+void
+Generator::anchorBox(int *box)
+{
+	int shorter = WIDTH < HEIGHT ? WIDTH : HEIGHT;
+	int csize   = (shorter * TAG_PERCENT) / 100;
+	int size    = (csize * 8) / 10;
+	int origin  = (csize - size) / 2;
+	int cell    = size / 2;
+	int margin  = cell / 10;
+	double angle = ((double)((ROTATION % 4) * 90 + TILT) * 3.1415926535897931) / 180.0;
+	double c = cos(angle), s = sin(angle), half = csize / 2.0, cx = 0, cy = 0;
+	cardCenter(&cx, &cy);
+	double minx = WIDTH, miny = HEIGHT, maxx = 0, maxy = 0;
+	for(int k = 0; k < 4; k++){
+		double u = (k % 2 == 0 ? origin + margin : origin + cell - margin) - half;
+		double v = (k / 2 == 0 ? origin + margin : origin + cell - margin) - half;
+		double x = cx + (u * c) + (v * s);
+		double y = cy - (u * s) + (v * c);
+		if( x < minx ) minx = x;
+		if( x > maxx ) maxx = x;
+		if( y < miny ) miny = y;
+		if( y > maxy ) maxy = y;
+	}
+	box[0] = (int) minx;
+	box[1] = (int) miny;
+	box[2] = (int)(maxx - minx);
+	box[3] = (int)(maxy - miny);
+}
+
+//inverse map every image pixel into the rotated card, bilinear sampled
+void
+Generator::placeCard()
+{
+	double angle = ((double)((ROTATION % 4) * 90 + TILT) * 3.1415926535897931) / 180.0;
+	double c = cos(angle), s = sin(angle);
+	double cx = 0, cy = 0, half = card_size / 2.0;
+	cardCenter(&cx, &cy);
+	double reach = half * 1.4143 + 1;
+
+	for(int y = 0; y < HEIGHT; y++){
+		unsigned char *row = buffer + (y * WIDTH);
+		double dy = (y + 0.5) - cy;
+		if( fabs(dy) > reach ){
+			memset(row, GEN_BACKGROUND, WIDTH);
+			continue;
+		}
+		for(int x = 0; x < WIDTH; x++){
+			double dx = (x + 0.5) - cx;
+			double u = (dx * c) - (dy * s) + half - 0.5;
+			double v = (dx * s) + (dy * c) + half - 0.5;
+			if( u < 0 || v < 0 || u >= card_size - 1 || v >= card_size - 1 ){
+				row[x] = GEN_BACKGROUND;
+				continue;
+			}
+			int iu = (int)u, iv = (int)v;
+			double fu = u - iu, fv = v - iv;
+			unsigned char *p = card + (iv * card_size) + iu;
+			double top = p[0] * (1 - fu) + p[1] * fu;
+			double bot = p[card_size] * (1 - fu) + p[card_size + 1] * fu;
+			row[x] = (unsigned char)(top * (1 - fv) + bot * fv + 0.5);
+		}
+	}
+}
+
+//boxes and frames kept clear of the card so the ground truth stays valid
+void
+Generator::drawClutter()
+{
+	int shorter = WIDTH < HEIGHT ? WIDTH : HEIGHT;
+	double cx = 0, cy = 0;
+	cardCenter(&cx, &cy);
+	double clear = card_size * 0.75;
+	int drawn = 0;
+	for(int tries = 0; drawn < CLUTTER && tries < CLUTTER * 50; tries++){
+		int w = shorter / 40 + random(shorter / 8 + 1);
+		int h = shorter / 40 + random(shorter / 8 + 1);
+		int x = random(WIDTH - w > 0 ? WIDTH - w : 1);
+		int y = random(HEIGHT - h > 0 ? HEIGHT - h : 1);
+		double nx = cx < x ? x : (cx > x + w ? x + w : cx); //nearest point to the centre
+		double ny = cy < y ? y : (cy > y + h ? y + h : cy);
+		if( sqrt((nx - cx) * (nx - cx) + (ny - cy) * (ny - cy)) < clear ) continue;
+		unsigned char grey = (unsigned char)(GEN_INK + random(120));
+		int frame = random(2) == 0 ? 0 : 2 + random(shorter / 80 + 1);
+		for(int j = y; j < y + h && j < HEIGHT; j++){
+			for(int i = x; i < x + w && i < WIDTH; i++){
+				if( frame > 0 && i >= x + frame && i < x + w - frame
+					&& j >= y + frame && j < y + h - frame ) continue;
+				buffer[(j * WIDTH) + i] = grey;
+			}
+		}
+		drawn++;
+	}
+}
+
+//separable running sum box blur
+void
+Generator::blurImage()
+{
+	if( BLUR <= 0 ) return;
+	int r = BLUR, longer = WIDTH > HEIGHT ? WIDTH : HEIGHT;
+	int *line = new int[longer];
+	for(int pass = 0; pass < 2; pass++){
+		int n     = pass == 0 ? WIDTH : HEIGHT;
+		int lines = pass == 0 ? HEIGHT : WIDTH;
+		int step  = pass == 0 ? 1 : WIDTH;
+		for(int l = 0; l < lines; l++){
+			unsigned char *p = buffer + (pass == 0 ? l * WIDTH : l);
+			for(int i = 0; i < n; i++) line[i] = p[i * step];
+			int sum = 0, count = 0;
+			for(int i = 0; i < r && i < n; i++) { sum += line[i]; count++; }
+			for(int i = 0; i < n; i++){
+				if( i + r < n )      { sum += line[i + r]; count++; }
+				if( i - r - 1 >= 0 ) { sum -= line[i - r - 1]; count--; }
+				p[i * step] = (unsigned char)(sum / count);
+			}
+		}
+	}
+	delete [] line;
+}
+
+void
+Generator::addNoise()
+{
+	if( NOISE <= 0 ) return;
+	int n = WIDTH * HEIGHT;
+	for(int i = 0; i < n; i++){
+		int v = buffer[i] + ((random(2 * NOISE + 1) + random(2 * NOISE + 1)) / 2) - NOISE;
+		buffer[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+}
+
+bool
+Generator::compress(j_compress_ptr cinfo)
+{
+	cinfo->image_width      = WIDTH;
+	cinfo->image_height     = HEIGHT;
+	cinfo->input_components = 1;
+	cinfo->in_color_space   = JCS_GRAYSCALE;
+	jpeg_set_defaults(cinfo);
+	jpeg_set_quality(cinfo, QUALITY, TRUE);
+	jpeg_start_compress(cinfo, TRUE);
+	while (cinfo->next_scanline < cinfo->image_height) {
+		JSAMPROW row = buffer + (cinfo->next_scanline * WIDTH);
+		(void) jpeg_write_scanlines(cinfo, &row, 1);
+	}
+	jpeg_finish_compress(cinfo);
+	return true;
+}
+
+bool
+Generator::writeImage(string filename)
+{
+	if(buffer == NULL) return false;
+	FILE *outfile = fopen(filename.c_str(), "wb");
+	if( outfile == NULL ){
+		fprintf(stderr, "can't open %s\n", filename.c_str());
+		return false;
+	}
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_stdio_dest(&cinfo, outfile);
+	compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+	fclose(outfile);
+	return true;
+}
+
+bool
+Generator::encodeImage(unsigned char **data, unsigned long *size)
+{
+	if(buffer == NULL) return false;
+	*data = NULL;
+	*size = 0;
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, data, size);
+	compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+	return true;
+}
@@ -0,0 +1,67 @@
+#ifndef _GENERATOR_H_INCLUDED
+#define _GENERATOR_H_INCLUDED
+
+#include <string>
+#include "common.h"
+extern "C" { //extern for MingW only, GNU and MSVC++ are fine
+	#include <jpeglib.h> /* IJG JPEG LIBRARAY */
+	#include <jerror.h>  /* IJG JPEG LIBRARAY */
+}
+
+using namespace std;
+
+/*
+* Renders synthetic tags with a known code, for benchmarks and accuracy tests
+*
+* The layout is the one Pattern and Matrix decode: a square anchor at the
+* top left and three groups (SIDE, BELOW, ACROSS) of four code blocks, each
+* block one of the Shape::matchBars()/matchBox() symbols.
+*
+* The tag is drawn on a white card (centered unless CENTER_X/Y) on a light grey background, then
+* rotated (quarter turns and tilt), blurred, cluttered and noised.
+* Same options and SEED always give the same image.
+*/
+class Generator
+{
+
+public:
+	Generator();
+	~Generator();
+
+	int  WIDTH, HEIGHT;	//image size
+	int  TAG_PERCENT;	//card size as percent of the shorter image side
+	int  ROTATION;		//quarter turns counter clockwise (0..3), moves the anchor corner
+	int  TILT;		//extra rotation in degrees, counter clockwise
+	int  BLUR;		//box blur radius in pixels (0 = sharp)
+	int  NOISE;		//noise amplitude in grey levels (0 = none)
+	int  CLUTTER;		//random shapes drawn around the card
+	int  QUALITY;		//jpeg quality 1..100
+	int  CENTER_X, CENTER_Y;	//card centre in image pixels, -1 is the image centre
+	unsigned int SEED;	//for code, clutter and noise
+
+	void randomCode(int *code);	//12 random digits from SEED
+	bool render(int *code);		//draw the image for this code
+	bool writeImage(string filename);
+	bool encodeImage(unsigned char **data, unsigned long *size); //jpeg in memory, free() it
+	unsigned char* getBuffer();	//8 bit grey, WIDTH*HEIGHT
+	void anchorBox(int *box);	//where the anchor is drawn: x, y, width, height in image pixels
+
+private:
+	unsigned char *buffer;
+	unsigned char *card;
+	int  card_size;
+	unsigned int state;
+
+	int  random(int n);
+	void fillCard(int x1, int y1, int x2, int y2);
+	void drawDigit(int digit, int x, int y, int s);
+	void drawCard(int *code);
+	void placeCard();
+	void cardCenter(double *cx, double *cy);
+	void drawClutter();
+	void blurImage();
+	void addNoise();
+	bool compress(j_compress_ptr cinfo);
+};
+
+#endif /* _GENERATOR_H_INCLUDED */
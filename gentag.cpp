@@ -0,0 +1,55 @@
+/*
+* Synthetic tag image writer, prints the file name and the code (ground truth)
+*
+*	gentag outfile.jpg [code|r] [width] [height] [rotation] [tilt]
+*			[blur] [noise] [clutter] [quality] [seed]
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "generator.h"
+
+int main(int argc,char **argv) {
+	int code[12];
+
+	if( argc < 2 ){
+		cerr << endl;
+		cerr << "Usage:" << endl;
+		cerr << "\t" << argv[0] << " outfile.jpg [code|r] [width] [height] [rotation] [tilt]" << endl;
+		cerr << "\t\t\t[blur] [noise] [clutter] [quality] [seed]" << endl;
+		cerr << endl;
+		cerr << "\tcode: 12 digits, r or default is random from seed" << endl;
+		cerr << "\trotation: quarter turns counter clockwise 0..3" << endl;
+		cerr << "\ttilt: degrees counter clockwise" << endl;
+		cerr << "\tblur: box blur radius, noise: grey levels, clutter: shape count" << endl;
+		cerr << endl;
+		return 1;
+	}
+
+	Generator* generator = new Generator();
+	if(argc >= 4  && atoi(argv[3]) > 0)  generator->WIDTH    = atoi(argv[3]);
+	if(argc >= 5  && atoi(argv[4]) > 0)  generator->HEIGHT   = atoi(argv[4]);
+	if(argc >= 6)                        generator->ROTATION = atoi(argv[5]);
+	if(argc >= 7)                        generator->TILT     = atoi(argv[6]);
+	if(argc >= 8)                        generator->BLUR     = atoi(argv[7]);
+	if(argc >= 9)                        generator->NOISE    = atoi(argv[8]);
+	if(argc >= 10)                       generator->CLUTTER  = atoi(argv[9]);
+	if(argc >= 11 && atoi(argv[10]) > 0) generator->QUALITY  = atoi(argv[10]);
+	if(argc >= 12)                       generator->SEED     = (unsigned int)atoi(argv[11]);
+
+	generator->randomCode(code);
+	if(argc >= 3 && strlen(argv[2]) == 12){
+		for(int i=0; i<12; i++) code[i] = argv[2][i] - '0';
+	}
+
+	bool ok = generator->render(code) && generator->writeImage(argv[1]);
+	if( ok ){
+		cout << argv[1] << " ";
+		for(int i=0; i<12; i++) cout << code[i];
+		cout << endl;
+	}else{
+		cerr << "could not render " << argv[1] << endl;
+	}
+	delete generator;
+	return ok ? 0 : 1;
+}
@@ -1,8 +1,17 @@
 #include "tagimage.h"
 
+//older MagickCore has the same call as DispatchImage
+#if defined(MagickLibVersion) && MagickLibVersion < 0x620
+#define ExportImagePixels DispatchImage
+#endif
+
 Tagimage::Tagimage(Config *_config)
 {
 	config = _config;
+	COLORS = 1;
+	plane  = NULL;
+	stride = 0;
+	wrapped = false;
 	ImageInfo *image_info = CloneImageInfo((ImageInfo *) NULL);
 	GetExceptionInfo(&exception);
 	strcpy(image_info->filename, config->TAG_IMAGE_FILE.c_str());
@@ -19,21 +28,60 @@ Tagimage::Tagimage(Config *_config)
 		valid  = true;
 		if(config->DEBUG) cout  << config->TAG_IMAGE_FILE 
 			<< " (" << width << "x" << height << ")" << endl;
+		if(config->PIXMAP_NATIVE_SCALE) resizeImage();
+		exportImage();
 	}
-	if(config->PIXMAP_NATIVE_SCALE) resizeImage();
+}
+
+/* camera frame already in memory, used in place (see tagimage.cpp) */
+Tagimage::Tagimage(Config *_config, unsigned char *luma, int _width, int _height, int _stride)
+{
+	config = _config;
+	COLORS = 1;
+	image  = NULL;
+	GetExceptionInfo(&exception);
+	plane  = luma;
+	width  = _width;
+	height = _height;
+	stride = _stride;
+	wrapped = true;
+	//as Probe does for files, a side must be longer than the threshold window
+	valid = plane != NULL && width > config->THRESHOLD_WINDOW_SIZE && height > config->THRESHOLD_WINDOW_SIZE 
+		&& stride >= width;
 }
 
 Tagimage::~Tagimage()
 {
-	DestroyImage(image);
+	if(image != NULL) DestroyImage(image);
 	DestroyExceptionInfo(&exception);
+	if(!wrapped) config->freePixbuf();
+}
+
+/* 
+* the whole image as 8 bit intensity into PIXBUF in one call, so Threshold 
+* reads it like a JPEG (computeEdgemapOpt on the plane) instead of a 
+* GetOnePixel() call for every pixel of every window 
+*/
+void
+Tagimage::exportImage()
+{
+	unsigned char *pixbuf = config->newPixbuf(width * height);
+	if( ExportImagePixels(image, 0, 0, width, height, "I", CharPixel, pixbuf, &exception) ){
+		plane  = pixbuf;
+		stride = width;
+	}else{
+		cerr << "Failed exporting image pixels: " << config->TAG_IMAGE_FILE << endl;
+		config->freePixbuf();
+		valid = false;
+	}
+	DestroyImage(image);
+	image = NULL;
 }
 
 int
 Tagimage::getPixel( int x, int y ) 
 {
-	PixelPacket pixel = GetOnePixel( image, x, y);
-	return ( pixel.red + pixel.green + pixel.blue );
+	return plane[(y * stride) + x];
 }
 
 int
@@ -50,10 +98,22 @@ Tagimage::getHeight()
 	return height;
 }
 
+unsigned char*
+Tagimage::getPlane()
+{
+	return plane;
+}
+
+int
+Tagimage::getStride()
+{
+	return stride;
+}
+
 bool
 Tagimage::isValid()
 {
-	if( image == NULL ) valid = false;
+	if( plane == NULL ) valid = false;
 	return valid;
 }
 
@@ -15,22 +15,30 @@ class Tagimage
 
 public:
 	Tagimage(Config *config);
+	Tagimage(Config *config, unsigned char *luma, int width, int height, int stride); //wraps, no copy
 	~Tagimage();
 	int  getPixel(int x, int y);
 	int  getWidth();
 	int  getHeight();
+	unsigned char* getPlane();	//8 bit grey, row y at getPlane() + y*getStride()
+	int  getStride();
 	bool isValid();
 	int  maxRGB();
+	int  COLORS;
 
 private:
-	Image *image;
+	Image *image;		//only while loading, exported to PIXBUF once
 	Config *config;
 	ExceptionInfo exception;
 	int width, height;
+	unsigned char *plane;	//PIXBUF, or the wrapped frame
+	int  stride;
+	bool wrapped;		//plane is not ours to free
 	bool valid;
-	static const int MAXRGB = 65535;
+	static const int MAXRGB = 256;
 	void resizeImage();
 	void resizeImage(int width, int height);
+	void exportImage();
 };
 
 #endif /* _TAGIMAGE_H_INCLUDED */
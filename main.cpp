@@ -9,10 +9,22 @@
 
 
 #include <time.h>
+#include <string.h>
 #include "decoder.h"
+#include "server.h"
 
 int main(int argc,char **argv) {
 	int tag[12];
+	Stats stats;
+
+#ifdef DECODE_SERVER
+	if(argc >= 3 && strcmp(argv[1], "-s") == 0) { 
+		Server* server = new Server(argc, argv);
+		bool ok = server->run();
+		delete server;
+		return ok ? 0 : 1;
+	}
+#endif
 
 	Decoder* decoder = new Decoder(argc, argv);
 	if(decoder->processTag()) { 
@@ -20,11 +32,15 @@ int main(int argc,char **argv) {
 		for(int i=0; i<12; i++) cout << tag[i];
 		cout << endl;
 	}
+	decoder->copyStats(&stats);
 	delete decoder;
 
 	//perf
 	if(argc > 3){ 
-		if(strcmp(argv[3], "t") == 0) cout << (float)clock()/(float)CLOCKS_PER_SEC << " Secs" << endl;
+		if(strcmp(argv[3], "t") == 0 || strcmp(argv[3], "m") == 0) { 
+			stats.print();
+			cout << (float)clock()/(float)CLOCKS_PER_SEC << " Secs" << endl;
+		}
 	}
 	//perf
 
@@ -0,0 +1,25 @@
+# production decoder and server, debug logging and visual debug compiled out
+# (use make-linux.sh for a build with the l|v|d|a options)
+CC="g++ -DPTHREAD -DPRODUCTION"
+set -x
+${CC} -O3 -I./jpeg/include -c main.cpp 
+${CC} -O3 -I./jpeg/include -c decoder.cpp 
+${CC} -O3 -I./jpeg/include -c tagimage.cpp 
+${CC} -O3 -I./jpeg/include -c pngreader.cpp 
+${CC} -O3 -I./jpeg/include -c pnmreader.cpp 
+${CC} -O3 -I./jpeg/include -c mappedfile.cpp 
+${CC} -O3 -I./jpeg/include -c probe.cpp 
+${CC} -O3 -I./jpeg/include -c pixmap.cpp  
+${CC} -O3 -I./jpeg/include -c config.cpp 
+${CC} -O3 -I./jpeg/include -c threshold.cpp 
+${CC} -O3 -I./jpeg/include -c downscaler.cpp 
+${CC} -O3 -I./jpeg/include -c border.cpp 
+${CC} -O3 -I./jpeg/include -c pattern.cpp 
+${CC} -O3 -I./jpeg/include -c matrix.cpp 
+${CC} -O3 -I./jpeg/include -c shape.cpp 
+${CC} -O3 -I./jpeg/include -c timer.cpp 
+${CC} -O3 -I./jpeg/include -c stats.cpp 
+${CC} -O3 -I./jpeg/include -c workqueue.cpp 
+${CC} -O3 -I./jpeg/include -c asyncdecoder.cpp 
+${CC} -O3 -I./jpeg/include -c server.cpp 
+${CC} -L./jpeg/lib/linux  main.o decoder.o tagimage.o pngreader.o pnmreader.o mappedfile.o probe.o pixmap.o  config.o threshold.o downscaler.o border.o pattern.o matrix.o shape.o timer.o stats.o workqueue.o asyncdecoder.o server.o -ljpeg -lpthread -o decode
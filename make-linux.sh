@@ -1,14 +1,32 @@
-CC=g++
+CC="g++ -DPTHREAD"
 set -x
 ${CC} -O3 -I./jpeg/include -c main.cpp 
 ${CC} -O3 -I./jpeg/include -c decoder.cpp 
 ${CC} -O3 -I./jpeg/include -c tagimage.cpp 
+${CC} -O3 -I./jpeg/include -c pngreader.cpp 
+${CC} -O3 -I./jpeg/include -c pnmreader.cpp 
+${CC} -O3 -I./jpeg/include -c mappedfile.cpp 
+${CC} -O3 -I./jpeg/include -c probe.cpp 
 ${CC} -O3 -I./jpeg/include -c pixmap.cpp  
 ${CC} -O3 -I./jpeg/include -c config.cpp 
 ${CC} -O3 -I./jpeg/include -c threshold.cpp 
+${CC} -O3 -I./jpeg/include -c downscaler.cpp 
 ${CC} -O3 -I./jpeg/include -c border.cpp 
 ${CC} -O3 -I./jpeg/include -c pattern.cpp 
 ${CC} -O3 -I./jpeg/include -c matrix.cpp 
 ${CC} -O3 -I./jpeg/include -c shape.cpp 
-${CC} -L./jpeg/lib/linux  main.o decoder.o tagimage.o pixmap.o  config.o threshold.o border.o pattern.o matrix.o shape.o  -ljpeg -o decode
-
+${CC} -O3 -I./jpeg/include -c timer.cpp 
+${CC} -O3 -I./jpeg/include -c stats.cpp 
+${CC} -O3 -I./jpeg/include -c workqueue.cpp 
+${CC} -O3 -I./jpeg/include -c asyncdecoder.cpp 
+${CC} -O3 -I./jpeg/include -c server.cpp 
+${CC} -L./jpeg/lib/linux  main.o decoder.o tagimage.o pngreader.o pnmreader.o mappedfile.o probe.o pixmap.o  config.o threshold.o downscaler.o border.o pattern.o matrix.o shape.o timer.o stats.o workqueue.o asyncdecoder.o server.o -ljpeg -lpthread -o decode
+${CC} -O3 -I./jpeg/include -c perfcounters.cpp 
+${CC} -O3 -I./jpeg/include -c benchalloc.cpp 
+${CC} -O3 -I./jpeg/include -c bench.cpp 
+${CC} -L./jpeg/lib/linux  bench.o benchalloc.o perfcounters.o decoder.o tagimage.o pngreader.o pnmreader.o mappedfile.o probe.o pixmap.o  config.o threshold.o downscaler.o border.o pattern.o matrix.o shape.o timer.o stats.o -ljpeg -lpthread -o bench
+${CC} -O3 -I./jpeg/include -c generator.cpp 
+${CC} -O3 -I./jpeg/include -c gentag.cpp 
+${CC} -L./jpeg/lib/linux  gentag.o generator.o -ljpeg -o gentag
+${CC} -O3 -I./jpeg/include -c throughput.cpp 
+${CC} -L./jpeg/lib/linux  throughput.o decoder.o tagimage.o pngreader.o pnmreader.o mappedfile.o probe.o pixmap.o  config.o threshold.o downscaler.o border.o pattern.o matrix.o shape.o timer.o stats.o workqueue.o asyncdecoder.o generator.o -ljpeg -lpthread -o throughput
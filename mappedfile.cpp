@@ -0,0 +1,103 @@
+#include "mappedfile.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+map<string, Mappedfile*> Mappedfile::mapped;
+#ifdef PTHREAD
+pthread_mutex_t Mappedfile::lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+Mappedfile::Mappedfile()
+{
+	data = NULL;
+	size = 0;
+	refs = 0;
+}
+
+Mappedfile::~Mappedfile()
+{
+#ifndef _WIN32
+	if(data != NULL) munmap(data, size);
+#endif
+}
+
+void
+Mappedfile::lockMapped()
+{
+#ifdef PTHREAD
+	pthread_mutex_lock(&lock);
+#endif
+}
+
+void
+Mappedfile::unlockMapped()
+{
+#ifdef PTHREAD
+	pthread_mutex_unlock(&lock);
+#endif
+}
+
+Mappedfile*
+Mappedfile::open(string filename)
+{
+#ifdef _WIN32
+	return NULL;
+#else
+	lockMapped();
+	map<string, Mappedfile*>::iterator it = mapped.find(filename);
+	if( it != mapped.end() ){
+		it->second->refs++;
+		unlockMapped();
+		return it->second;
+	}
+
+	Mappedfile *file = NULL;
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if( fd >= 0 ){
+		struct stat st;
+		if( fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= 0x7fffffff ){
+			void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if( data != MAP_FAILED ){
+				madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+				file = new Mappedfile();
+				file->filename = filename;
+				file->data = (unsigned char *) data;
+				file->size = (int) st.st_size;
+				file->refs = 1;
+				mapped[filename] = file;
+			}
+		}
+		close(fd); //the mapping stays valid
+	}
+	unlockMapped();
+	return file;
+#endif
+}
+
+void
+Mappedfile::release()
+{
+	lockMapped();
+	bool last = --refs == 0;
+	if( last ) mapped.erase(filename);
+	unlockMapped();
+	if( last ) delete this;
+}
+
+unsigned char*
+Mappedfile::getData()
+{
+	return data;
+}
+
+int
+Mappedfile::getSize()
+{
+	return size;
+}
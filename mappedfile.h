@@ -0,0 +1,52 @@
+#ifndef _MAPPEDFILE_H_INCLUDED
+#define _MAPPEDFILE_H_INCLUDED
+
+#include <string>
+#include <map>
+#include "common.h"
+
+#ifdef PTHREAD
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+/*
+* Read only memory mapping of a whole image file (POSIX mmap, with a 
+* sequential access hint) so the decoders read it in place, no stdio 
+* buffering and no copy.
+*
+* Mappings are shared: open() of a file that is already mapped returns 
+* the same mapping with one more reference, so the threads of a batch job 
+* decoding the same files map each file once. release() drops a reference, 
+* the last one unmaps. open() returns NULL when the file can not be mapped 
+* (missing, empty, not a regular file, or no mmap on this platform), 
+* the caller then reads the file the usual way.
+*/
+class Mappedfile
+{
+
+public:
+	static Mappedfile* open(string filename);
+	void release();
+	unsigned char* getData();
+	int  getSize();
+
+private:
+	Mappedfile();
+	~Mappedfile();
+
+	string filename;
+	unsigned char *data;
+	int  size;
+	int  refs;
+
+	static map<string, Mappedfile*> mapped;
+#ifdef PTHREAD
+	static pthread_mutex_t lock;
+#endif
+	static void lockMapped();
+	static void unlockMapped();
+};
+
+#endif /* _MAPPEDFILE_H_INCLUDED */
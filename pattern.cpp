@@ -11,6 +11,7 @@ Pattern::Pattern(Config *_config, Shape* _shapes, int _nshapes, Shape* _anchor)
 	center_y = config->GRID_HEIGHT/2;
 
 	for(int i = 0; i < 12; i++) codeblock[i] = -9;
+	for(int i = 0; i < 12; i++) blockconf[i] = 0;
 
 	anchor_at    = TOP_LEFT; //default
 	anchor_tilt  = 0; 
@@ -19,10 +20,15 @@ Pattern::Pattern(Config *_config, Shape* _shapes, int _nshapes, Shape* _anchor)
 	group_size   = 0;
 	starting_group_size  = 0;
 	anchor_offset  = 0;
+	hint_anchor_at = 0;
+	hint_tilt      = 0;
+	total_tilt     = 0;
 	rotate_delta_x = 0;
 	rotate_delta_y = 0;
+#ifndef PRODUCTION
 	debug       = config->DEBUG;
 	pixdebug    = config->CHECK_VISUAL_DEBUG();
+#endif
 	if(pixdebug) pixmap = config->DBGPIXMAP;
 	else         pixmap = NULL;
 
@@ -35,10 +41,21 @@ Pattern::~Pattern()
 void
 Pattern::findCode(int* tag)
 {
+	Stats *stats = config->STATS;
+	long long mark = Timer::now();
 	if(pixdebug)      d_writeShapes((string)"selectedshapes");
-	if(findTilt())    rotateShapes();
-	if(findTilt())    rotateShapes();//FIXME 
+	if( hint_tilt != 0 ){ //seeded from the last frame, one refinement
+		anchor_tilt = hint_tilt;
+		rotateShapes();
+		if(findTilt()) rotateShapes();
+	}else{
+		if(findTilt())    rotateShapes();
+		if(findTilt())    rotateShapes();//FIXME 
+	}
+	stats->tilt = Timer::now() - mark;
+	mark = Timer::now();
 	if(findPattern()) finalPattern(tag);
+	stats->pattern = Timer::now() - mark;
 	if(debug) 	  d_printPattern();
 }
 
@@ -53,36 +70,64 @@ Pattern::findPattern()
 
 	locateAnchor(); //works 95% of the time
 
-	if(findBlocks()) return true;
-	if(debug) d_printPattern();
-
-	int already_tried_anchor_at = anchor_at;
+	//the last frame or the EXIF orientation says where the anchor was stored,
+	//that corner goes first and the geometric guess second
+	int tries[4] = { 0, 0, 0, 0 }, ntries = 0;
+	int hint = hint_anchor_at != 0 ? hint_anchor_at : orientationAnchor();
+	if( hint != 0 ) tries[ntries++] = hint;
+	if( anchor_at != hint ) tries[ntries++] = anchor_at;
 	for(int i=1; i<5; i++){ //brute force the rest 5% cases
-		if( i != already_tried_anchor_at ){
-			anchor_at = i;
-			group_size = starting_group_size;
-			code_pivot_x = anchor->getminx();
-			code_pivot_y = anchor->getminy();
-			if(findBlocks()) return true;
-			if(debug) d_printPattern();
-		}
+		if( i != tries[0] && i != tries[1] ) tries[ntries++] = i;
+	}
+
+	for(int i=0; i<ntries; i++){
+		anchor_at = tries[i];
+		group_size = starting_group_size;
+		code_pivot_x = anchor->getminx();
+		code_pivot_y = anchor->getminy();
+		if( i > 0 ) config->STATS->orientation_retries++;
+		if(findBlocks()) return true;
+		if(debug) d_printPattern();
 	}
 	return false;
 }
 
+/* 
+* an orientation is dropped as soon as a group has a block that did not 
+* match or is less sure than PATTERN_CONFIDENCE_FLOOR, the next one tried 
+*/
 bool
 Pattern::findBlocks()
 {
+	for(int i = 0; i < 12; i++) codeblock[i] = -9;
+	for(int i = 0; i < 12; i++) blockconf[i] = 0;
+
 	if(pixdebug) pixmap->setPen(255, 0, 0);
 	if( ! idGroup( SIDE ))   return false;
+	if( ! confidentGroup( SIDE ))   return false;
 
 	if(pixdebug) pixmap->setPen(0, 255, 0);
 	if( ! idGroup( BELOW ))  return false;
+	if( ! confidentGroup( BELOW ))  return false;
 
 	if(pixdebug) pixmap->setPen(0, 0, 255);
 	if( ! idGroup( ACROSS )) return false;
+	if( ! confidentGroup( ACROSS )) return false;
+
 
+	return true;
+}
 
+bool
+Pattern::confidentGroup(int gid)
+{
+	for(int i = (gid-1) * 4; i < gid * 4; i++){
+		if( codeblock[i] < 0 || blockconf[i] < config->PATTERN_CONFIDENCE_FLOOR ){
+			if(debug) cout << "Unsure block group, group id=" << gid 
+				<< " block=" << codeblock[i] << " confidence=" << blockconf[i] << endl;
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -179,6 +224,7 @@ Pattern::idBlock(int minx, int miny, int maxx, int maxy, int gid, int i)
 	int bid = locateBlock(minx, miny, maxx, maxy, i);
 	int index = ((gid-1) * 4) + bid-1;
 	codeblock[index] = matchPattern(i);  	  
+	blockconf[index] = shapes[i].getConfidence();
 	if(debug) cout << "CODE=" << codeblock[index] << "[" << index << " : i=" 
 		<< i << " g=" << gid << " b=" << bid << "]" << endl;
 }
@@ -189,6 +235,7 @@ Pattern::idBlock(int x, int y, int gid, int i, int groupsize_delta)
 	int bid = locateBlock(x, y, i, groupsize_delta);
 	int index = ((gid-1) * 4) + bid-1;
 	codeblock[index] = matchPattern(i); 
+	blockconf[index] = shapes[i].getConfidence();
 	if(debug) cout << "CODE=" << codeblock[index] << "[" << index << " : i=" 
 		<< i << " g=" << gid << " b=" << bid << "]" << endl;
 }
@@ -371,6 +418,22 @@ Pattern::getGroupy(int id)
 }
 
 
+/* corner the anchor of an upright tag is stored at for the image EXIF 
+ * orientation, 0 when upright or mirrored (no rotation to hint at)
+ * 6: shown turned 90 CW, so the upright top left was stored bottom left
+ * 8: shown turned 90 CCW, stored top right
+ * 3: shown turned 180, stored bottom right */
+int
+Pattern::orientationAnchor()
+{
+	switch(config->IMAGE_ORIENTATION){
+		case 3: return BOT_RIGHT;
+		case 6: return BOT_LEFT;
+		case 8: return TOP_RIGHT;
+	}
+	return 0;
+}
+
 void
 Pattern::locateAnchor()
 {
@@ -490,10 +553,38 @@ Pattern::computeRotatedGrid(int angle)
 		<< " " << config->GRID_HEIGHT << "]" << endl;
 }
 
+void
+Pattern::setHint(int _anchor_at, int _tilt)
+{
+	hint_anchor_at = _anchor_at;
+	hint_tilt      = _tilt;
+}
+
+int
+Pattern::getAnchorAt()
+{
+	return anchor_at;
+}
+
+int
+Pattern::getTilt()
+{
+	return total_tilt;
+}
+
+int
+Pattern::getConfidence()
+{
+	int confidence = 100;
+	for(int i = 0; i < 12; i++) if( blockconf[i] < confidence ) confidence = blockconf[i];
+	return confidence;
+}
+
 void
 Pattern::rotateShapes()
 {
 	if( anchor_tilt == 0 ) return;
+	total_tilt += anchor_tilt;
 	if(config->PESSIMISTIC_ROTATION) computeRotatedGrid(anchor_tilt);
 
 	if(pixdebug) pixmap->clearPixmap();
@@ -5,6 +5,7 @@
 #include "shape.h"
 #include "matrix.h"
 #include "pixmap.h"
+#include "timer.h"
 #include "common.h"
 
 #define TOP_LEFT 1
@@ -32,6 +33,10 @@ public:
 	bool _findTilt();  
 	int  findAngle(int x1, int y1, int x2, int y2, int orientation);  
 	void rotateShapes(); 
+	void setHint(int anchor_at, int tilt); //same tag in the last frame (stream mode), 0 is none
+	int  getAnchorAt();
+	int  getTilt();        //total correction applied by rotateShapes()
+	int  getConfidence();  //of the tag found, its least certain block (0..100)
 
 	//debug only
 	void d_printPattern();
@@ -48,7 +53,11 @@ private:
 	int anchor_at;	     //defaults at top left, but can be at any corner for rotated images
 	int anchor_tilt;     //for tilt correction
 	int anchor_offset;
+	int hint_anchor_at;  //corner to try first, 0 leaves it to the EXIF orientation
+	int hint_tilt;       //rotation applied before measuring the tilt
+	int total_tilt;
 	int codeblock[12];
+	int blockconf[12];   //Shape::getConfidence() of each block
 	int code[12];
 	int center_x, center_y; 	    //center of the image ( used for rotateShapes )
 	int rotate_delta_x, rotate_delta_y; //grid resize after rotate, delta used in rotateShape()
@@ -63,10 +72,12 @@ private:
 	int  getGroupx(int i);
 	int  getGroupy(int i);
 	void locateAnchor();
+	int  orientationAnchor();
 	bool findPattern();
 	bool findBlocks();
 	int  matchPattern(int i);
 	bool validPattern();
+	bool confidentGroup(int id);
 	void printCodeBlock();
 	void resizeGroup(int delta);
 	void computeRotatedGrid(int angle);
@@ -74,8 +85,13 @@ private:
 
 	//debug only
 	Pixmap *pixmap;
+#ifdef PRODUCTION
+	static const bool debug = false;
+	static const bool pixdebug = false;
+#else
 	bool debug;
 	bool pixdebug;
+#endif
 
 	void d_debugShapes();
 	void d_writeShapes();
@@ -0,0 +1,153 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char *perf_names[PERF_COUNTERS] = {
+	"cycles", "instructions", "cache-references", "cache-misses",
+	"branches", "branch-misses", "stalled-frontend", "stalled-backend"
+};
+
+Perfcounters::Perfcounters()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		fds[i] = -1;
+		counts[i] = 0;
+	}
+	error = "";
+}
+
+Perfcounters::~Perfcounters()
+{
+	close();
+}
+
+const char*
+Perfcounters::name(int counter)
+{
+	if( counter < 0 || counter >= PERF_COUNTERS ) return "";
+	return perf_names[counter];
+}
+
+string
+Perfcounters::getError()
+{
+	return error;
+}
+
+bool
+Perfcounters::isAvailable(int counter)
+{
+	return fds[counter] >= 0;
+}
+
+long long
+Perfcounters::get(int counter)
+{
+	return fds[counter] >= 0 ? counts[counter] : -1;
+}
+
+void
+Perfcounters::reset()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++) counts[i] = 0;
+}
+
+#ifdef __linux__
+
+static const unsigned long long perf_configs[PERF_COUNTERS] = {
+	PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, PERF_COUNT_HW_STALLED_CYCLES_BACKEND
+};
+
+bool
+Perfcounters::open()
+{
+	close();
+	int opened = 0;
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size           = sizeof(attr);
+		attr.type           = PERF_TYPE_HARDWARE;
+		attr.config         = perf_configs[i];
+		attr.disabled       = 1;
+		attr.exclude_kernel = 1; //allowed up to perf_event_paranoid 2
+		attr.exclude_hv     = 1;
+		attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if( fds[i] >= 0 ) opened++;
+		else if( error == "" ) error = string(name(i)) + ": " + strerror(errno);
+	}
+	if( opened == 0 ) return false;
+	return true;
+}
+
+void
+Perfcounters::close()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		if( fds[i] >= 0 ) ::close(fds[i]);
+		fds[i] = -1;
+	}
+}
+
+void
+Perfcounters::start()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		if( fds[i] < 0 ) continue;
+		ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+void
+Perfcounters::stop()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		if( fds[i] >= 0 ) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+	for(int i = 0; i < PERF_COUNTERS; i++){
+		if( fds[i] < 0 ) continue;
+		unsigned long long values[3]; //value, time enabled, time running
+		if( read(fds[i], values, sizeof(values)) != (ssize_t) sizeof(values) ) continue;
+		if( values[2] == 0 ) continue; //never scheduled on the pmu
+		if( values[2] < values[1] ) values[0] = (unsigned long long)((double)values[0] * values[1] / values[2]);
+		counts[i] += (long long) values[0];
+	}
+}
+
+#else
+
+bool
+Perfcounters::open()
+{
+	error = "hardware counters need linux perf_event_open";
+	return false;
+}
+
+void
+Perfcounters::close()
+{
+}
+
+void
+Perfcounters::start()
+{
+}
+
+void
+Perfcounters::stop()
+{
+}
+
+#endif
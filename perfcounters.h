@@ -0,0 +1,53 @@
+#ifndef _PERFCOUNTERS_H_INCLUDED
+#define _PERFCOUNTERS_H_INCLUDED
+
+#include <string>
+#include "common.h"
+
+#define PERF_CYCLES            0
+#define PERF_INSTRUCTIONS      1
+#define PERF_CACHE_REFERENCES  2
+#define PERF_CACHE_MISSES      3
+#define PERF_BRANCHES          4
+#define PERF_BRANCH_MISSES     5
+#define PERF_STALLED_FRONTEND  6
+#define PERF_STALLED_BACKEND   7
+#define PERF_COUNTERS          8
+
+using namespace std;
+
+/*
+* Hardware counters of the calling thread (linux perf_event_open, user space
+* only) accumulated over start()/stop() pairs.
+*
+* Each counter is opened on its own, so a counter the cpu or the kernel
+* (perf_event_paranoid, containers) does not allow is just unavailable,
+* get() returns -1 for it. Counts are scaled when the kernel multiplexes.
+* On other platforms open() fails and everything is unavailable.
+*/
+class Perfcounters
+{
+
+public:
+	Perfcounters();
+	~Perfcounters();
+
+	bool open();			//false if no counter could be opened, see getError()
+	void start();
+	void stop();			//add the counts since start()
+	void reset();			//clear the accumulated counts
+	bool isAvailable(int counter);
+	long long get(int counter);	//accumulated count, -1 if unavailable
+	string getError();
+
+	static const char* name(int counter);
+
+private:
+	int  fds[PERF_COUNTERS];
+	long long counts[PERF_COUNTERS];
+	string error;
+
+	void close();
+};
+
+#endif /* _PERFCOUNTERS_H_INCLUDED */
@@ -0,0 +1,456 @@
+#include "pngreader.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FAST_BITS 9	//Huffman codes up to this long decode with one table lookup
+#define MAX_BITS  15
+
+struct Huffman {
+	short count[MAX_BITS + 1];	//codes of each length
+	short symbol[288];		//symbols in canonical order
+	short fast[1 << FAST_BITS];	//(symbol << 4) | length by the next FAST_BITS input bits, 0 if longer
+};
+
+struct Inflater {
+	unsigned char *in;
+	int  insize, inpos;
+	unsigned int bitbuf;
+	int  bitcnt;
+	int  overrun;			//zero bytes fed past the end of the input
+	unsigned char *out;
+	int  outsize, outpos;
+};
+
+static const short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const short LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const short DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const short DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static inline void
+needBits(Inflater *s, int n)
+{
+	while( s->bitcnt < n ){
+		unsigned int b = 0;
+		if( s->inpos < s->insize ) b = s->in[s->inpos++];
+		else s->overrun++;
+		s->bitbuf |= b << s->bitcnt;
+		s->bitcnt += 8;
+	}
+}
+
+static inline int
+getBits(Inflater *s, int n)
+{
+	needBits(s, n);
+	int v = s->bitbuf & ((1 << n) - 1);
+	s->bitbuf >>= n;
+	s->bitcnt -= n;
+	return v;
+}
+
+//canonical code from the code lengths, false if over subscribed
+static bool
+buildHuffman(Huffman *h, unsigned char *lengths, int n)
+{
+	short offset[MAX_BITS + 2];
+	memset(h->count, 0, sizeof(h->count));
+	memset(h->fast, 0, sizeof(h->fast));
+	for(int i = 0; i < n; i++) h->count[lengths[i]]++;
+	h->count[0] = 0;
+
+	int left = 1;
+	for(int len = 1; len <= MAX_BITS; len++){
+		left = (left << 1) - h->count[len];
+		if( left < 0 ) return false;
+	}
+
+	offset[1] = 0;
+	for(int len = 1; len <= MAX_BITS; len++) offset[len + 1] = offset[len] + h->count[len];
+	for(int i = 0; i < n; i++) if( lengths[i] != 0 ) h->symbol[offset[lengths[i]]++] = i;
+
+	//the fast table is indexed by the input bits, which hold the code bit reversed
+	int code = 0, k = 0;
+	for(int len = 1; len <= FAST_BITS; len++){
+		for(int i = 0; i < h->count[len]; i++, k++, code++){
+			int rev = 0;
+			for(int b = 0; b < len; b++) rev |= ((code >> b) & 1) << (len - 1 - b);
+			for(int j = rev; j < (1 << FAST_BITS); j += (1 << len)) h->fast[j] = (h->symbol[k] << 4) | len;
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+static int
+decodeSymbol(Inflater *s, Huffman *h)
+{
+	needBits(s, MAX_BITS);
+	int e = h->fast[s->bitbuf & ((1 << FAST_BITS) - 1)];
+	if( e != 0 ){
+		s->bitbuf >>= (e & 15);
+		s->bitcnt -= (e & 15);
+		return e >> 4;
+	}
+	//longer codes one bit at a time
+	int code = 0, first = 0, index = 0;
+	for(int len = 1; len <= MAX_BITS; len++){
+		code |= getBits(s, 1);
+		int count = h->count[len];
+		if( code - count < first ) return h->symbol[index + (code - first)];
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+static bool
+inflateCodes(Inflater *s, Huffman *lencode, Huffman *distcode)
+{
+	for(;;){
+		if( s->overrun > 4 ) return false;
+		int sym = decodeSymbol(s, lencode);
+		if( sym < 0 ) return false;
+		if( sym < 256 ){
+			if( s->outpos >= s->outsize ) return false;
+			s->out[s->outpos++] = (unsigned char) sym;
+		}else if( sym == 256 ){
+			return true;
+		}else{
+			sym -= 257;
+			if( sym >= 29 ) return false;
+			int len = LENGTH_BASE[sym] + getBits(s, LENGTH_EXTRA[sym]);
+			int dsym = decodeSymbol(s, distcode);
+			if( dsym < 0 || dsym >= 30 ) return false;
+			int dist = DIST_BASE[dsym] + getBits(s, DIST_EXTRA[dsym]);
+			if( dist > s->outpos || s->outpos + len > s->outsize ) return false;
+			unsigned char *d = s->out + s->outpos;
+			for(int i = 0; i < len; i++) d[i] = d[i - dist]; //may overlap
+			s->outpos += len;
+		}
+	}
+}
+
+static bool
+inflateStored(Inflater *s)
+{
+	getBits(s, s->bitcnt & 7); //to the byte boundary
+	int len  = getBits(s, 16);
+	int nlen = getBits(s, 16);
+	if( (len ^ 0xffff) != nlen || s->outpos + len > s->outsize ) return false;
+	while( len > 0 && s->bitcnt >= 8 ){ //bytes already in the bit buffer
+		s->out[s->outpos++] = (unsigned char) getBits(s, 8);
+		len--;
+	}
+	if( s->inpos + len > s->insize ) return false;
+	memcpy(s->out + s->outpos, s->in + s->inpos, len);
+	s->outpos += len;
+	s->inpos += len;
+	return true;
+}
+
+static bool
+inflateDynamic(Inflater *s, Huffman *lencode, Huffman *distcode)
+{
+	static const int order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	unsigned char lengths[320];
+	int nlen  = getBits(s, 5) + 257;
+	int ndist = getBits(s, 5) + 1;
+	int ncode = getBits(s, 4) + 4;
+	if( nlen > 286 || ndist > 30 ) return false;
+
+	memset(lengths, 0, sizeof(lengths));
+	for(int i = 0; i < ncode; i++) lengths[order[i]] = (unsigned char) getBits(s, 3);
+	if( ! buildHuffman(lencode, lengths, 19) ) return false;
+
+	int i = 0;
+	while( i < nlen + ndist ){
+		int sym = decodeSymbol(s, lencode);
+		if( sym < 0 ) return false;
+		if( sym < 16 ){
+			lengths[i++] = (unsigned char) sym;
+			continue;
+		}
+		int len = 0, repeat = 0;
+		if( sym == 16 ){
+			if( i == 0 ) return false;
+			len = lengths[i - 1];
+			repeat = 3 + getBits(s, 2);
+		}else if( sym == 17 ){
+			repeat = 3 + getBits(s, 3);
+		}else{
+			repeat = 11 + getBits(s, 7);
+		}
+		if( i + repeat > nlen + ndist ) return false;
+		while( repeat-- > 0 ) lengths[i++] = (unsigned char) len;
+	}
+	if( lengths[256] == 0 ) return false; //no end of block code
+	if( ! buildHuffman(lencode, lengths, nlen) ) return false;
+	if( ! buildHuffman(distcode, lengths + nlen, ndist) ) return false;
+	return inflateCodes(s, lencode, distcode);
+}
+
+//zlib stream into exactly outsize bytes
+static bool
+inflateZlib(unsigned char *in, int insize, unsigned char *out, int outsize)
+{
+	if( insize < 2 || (in[0] & 15) != 8 || (in[1] & 32) != 0 || ((in[0] << 8) | in[1]) % 31 != 0 ) return false;
+
+	Inflater s;
+	s.in = in;
+	s.insize = insize;
+	s.inpos = 2;
+	s.bitbuf = 0;
+	s.bitcnt = 0;
+	s.overrun = 0;
+	s.out = out;
+	s.outsize = outsize;
+	s.outpos = 0;
+
+	Huffman *lencode  = new Huffman;
+	Huffman *distcode = new Huffman;
+	bool ok = true, last = false;
+	while( ok && ! last ){
+		last = getBits(&s, 1) == 1;
+		int type = getBits(&s, 2);
+		if( type == 0 ){
+			ok = inflateStored(&s);
+		}else if( type == 1 ){
+			unsigned char lengths[320];
+			int i = 0;
+			for(; i < 144; i++) lengths[i] = 8;
+			for(; i < 256; i++) lengths[i] = 9;
+			for(; i < 280; i++) lengths[i] = 7;
+			for(; i < 288; i++) lengths[i] = 8;
+			for(; i < 320; i++) lengths[i] = 5;
+			ok = buildHuffman(lencode, lengths, 288) && buildHuffman(distcode, lengths + 288, 30)
+				&& inflateCodes(&s, lencode, distcode);
+		}else if( type == 2 ){
+			ok = inflateDynamic(&s, lencode, distcode);
+		}else{
+			ok = false;
+		}
+		if( s.overrun > 4 ) ok = false;
+	}
+	delete lencode;
+	delete distcode;
+	return ok && s.outpos == outsize;
+}
+
+static inline int
+paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if( pa <= pb && pa <= pc ) return a;
+	return pb <= pc ? b : c;
+}
+
+//undo the row filter in place, prev is the unfiltered row above (zeros for the first)
+static bool
+unfilterRow(int type, unsigned char *row, unsigned char *prev, int rowbytes, int bpp)
+{
+	switch(type){
+		case 0:
+			break;
+		case 1:
+			for(int i = bpp; i < rowbytes; i++) row[i] += row[i - bpp];
+			break;
+		case 2:
+			for(int i = 0; i < rowbytes; i++) row[i] += prev[i];
+			break;
+		case 3:
+			for(int i = 0; i < bpp; i++) row[i] += prev[i] >> 1;
+			for(int i = bpp; i < rowbytes; i++) row[i] += (row[i - bpp] + prev[i]) >> 1;
+			break;
+		case 4:
+			for(int i = 0; i < bpp; i++) row[i] += prev[i];
+			for(int i = bpp; i < rowbytes; i++) row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+static inline unsigned char
+luma(int r, int g, int b)
+{
+	return (unsigned char)(((77 * r) + (150 * g) + (29 * b) + 128) >> 8);
+}
+
+static inline unsigned char
+overWhite(int v, int alpha)
+{
+	return (unsigned char)(((v * alpha) + (255 * (255 - alpha)) + 127) / 255);
+}
+
+static inline unsigned int
+readInt(unsigned char *p)
+{
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+bool
+Pngreader::isPng(unsigned char *data, int size)
+{
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	return size >= 8 && memcmp(data, signature, 8) == 0;
+}
+
+static bool
+isSupported(int colortype, int depth, int interlace)
+{
+	if( interlace != 0 ) return false;
+	if( colortype != 0 && colortype != 2 && colortype != 3 && colortype != 4 && colortype != 6 ) return false;
+	return depth == 8 || (depth == 16 && colortype != 3)
+		|| ((depth == 1 || depth == 2 || depth == 4) && (colortype == 0 || colortype == 3));
+}
+
+//IHDR only (always the first chunk)
+bool
+Pngreader::readHeader(unsigned char *data, int size, int *width, int *height, bool *supported)
+{
+	if( ! isPng(data, size) || size < 8 + 8 + 13 || memcmp(data + 12, "IHDR", 4) != 0 ) return false;
+	unsigned char *chunk = data + 16;
+	*width  = (int) readInt(chunk);
+	*height = (int) readInt(chunk + 4);
+	*supported = *width > 0 && *height > 0 && isSupported(chunk[9], chunk[8], chunk[12]);
+	return true;
+}
+
+bool
+Pngreader::read(Config *config, unsigned char *data, int size, int *width, int *height)
+{
+	if( ! isPng(data, size) ) return false;
+
+	int w = 0, h = 0, depth = 0, colortype = -1, interlace = 0;
+	unsigned char palette[256];	//palette entries as grey
+	memset(palette, 0, sizeof(palette));
+	int idat_size = 0;
+
+	//first pass: header, palette and the total IDAT size
+	int pos = 8;
+	while( pos + 12 <= size ){
+		unsigned int len = readInt(data + pos);
+		unsigned char *type = data + pos + 4;
+		unsigned char *chunk = data + pos + 8;
+		if( len > (unsigned int)(size - pos - 12) ) break;
+		if( memcmp(type, "IHDR", 4) == 0 && len >= 13 ){
+			w = (int) readInt(chunk);
+			h = (int) readInt(chunk + 4);
+			depth = chunk[8];
+			colortype = chunk[9];
+			interlace = chunk[12];
+		}else if( memcmp(type, "PLTE", 4) == 0 ){
+			for(unsigned int i = 0; i < len / 3 && i < 256; i++)
+				palette[i] = luma(chunk[i*3], chunk[(i*3)+1], chunk[(i*3)+2]);
+		}else if( memcmp(type, "IDAT", 4) == 0 ){
+			idat_size += len;
+		}else if( memcmp(type, "IEND", 4) == 0 ){
+			break;
+		}
+		pos += len + 12;
+	}
+
+	int channels = 0;
+	switch(colortype){
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+	}
+	bool depth_ok = isSupported(colortype, depth, 0);
+	if( idat_size == 0 ){
+		fprintf(stderr, "PNG Error : no image data\n");
+		return false;
+	}
+	if( w <= 0 || h <= 0 || channels == 0 || ! depth_ok ){
+		fprintf(stderr, "PNG Error : unsupported image %dx%d type %d depth %d\n", w, h, colortype, depth);
+		return false;
+	}
+	if( interlace != 0 ){
+		fprintf(stderr, "PNG Error : interlaced images not supported\n");
+		return false;
+	}
+	long long rowbytes = (((long long)w * channels * depth) + 7) / 8;
+	if( (rowbytes + 1) * h > 0x7fffffff || (long long) w * h > Config::MAX_IMAGE_PIXELS ){
+		fprintf(stderr, "PNG Error : image too large\n");
+		return false;
+	}
+	int bpp = (channels * depth) / 8; //filter byte distance
+	if( bpp < 1 ) bpp = 1;
+
+	//second pass: the IDAT chunks joined into one zlib stream
+	unsigned char *zdata = new unsigned char[idat_size];
+	int zpos = 0;
+	pos = 8;
+	while( pos + 12 <= size && zpos < idat_size ){
+		unsigned int len = readInt(data + pos);
+		if( len > (unsigned int)(size - pos - 12) ) break;
+		if( memcmp(data + pos + 4, "IDAT", 4) == 0 ){
+			memcpy(zdata + zpos, data + pos + 8, len);
+			zpos += len;
+		}
+		pos += len + 12;
+	}
+
+	int stride = (int) rowbytes + 1; //filter type byte and the row
+	unsigned char *raw = new unsigned char[stride * h];
+	bool ok = inflateZlib(zdata, idat_size, raw, stride * h);
+	delete [] zdata;
+	if( ! ok ){
+		fprintf(stderr, "PNG Error : corrupt image data\n");
+		delete [] raw;
+		return false;
+	}
+
+	unsigned char *pixbuf = config->newPixbuf(w * h);
+	unsigned char *zeros = new unsigned char[stride];
+	memset(zeros, 0, stride);
+	int maxval = (1 << depth) - 1;
+	int step = depth == 16 ? 2 : 1; //bytes per sample, 8 and 16 bit
+	for(int y = 0; y < h && ok; y++){
+		unsigned char *row = raw + (y * stride) + 1;
+		unsigned char *prev = y > 0 ? row - stride : zeros;
+		ok = unfilterRow(row[-1], row, prev, (int) rowbytes, bpp);
+		unsigned char *dst = pixbuf + (y * w);
+		if( depth < 8 ){
+			for(int x = 0; x < w; x++){
+				int bit = x * depth;
+				int v = (row[bit >> 3] >> (8 - depth - (bit & 7))) & maxval;
+				dst[x] = colortype == 3 ? palette[v] : (unsigned char)((v * 255) / maxval);
+			}
+		}else if( colortype == 0 && step == 1 ){
+			memcpy(dst, row, w);
+		}else{
+			for(int x = 0; x < w; x++){
+				unsigned char *p = row + (x * channels * step); //high byte of each sample
+				switch(colortype){
+					case 0: dst[x] = p[0]; break;
+					case 2: dst[x] = luma(p[0], p[step], p[2*step]); break;
+					case 3: dst[x] = palette[p[0]]; break;
+					case 4: dst[x] = overWhite(p[0], p[step]); break;
+					case 6: dst[x] = overWhite(luma(p[0], p[step], p[2*step]), p[3*step]); break;
+				}
+			}
+		}
+	}
+	delete [] zeros;
+	delete [] raw;
+	if( ! ok ){
+		fprintf(stderr, "PNG Error : bad row filter\n");
+		config->freePixbuf();
+		return false;
+	}
+	*width  = w;
+	*height = h;
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef _PNGREADER_H_INCLUDED
+#define _PNGREADER_H_INCLUDED
+
+#include "common.h"
+
+/*
+* PNG images read straight into the 8 bit grey PIXBUF without libpng or
+* zlib, the IDAT stream is inflated here (stored, fixed and dynamic
+* Huffman blocks) and unfiltered in place
+*
+* grey, grey+alpha, RGB, RGBA and palette, all bit depths, color as luma
+* and alpha blended over white, 16 bit samples use the high byte
+* not supported: interlaced (Adam7) images, chunk CRCs are not checked
+*/
+class Pngreader
+{
+
+public:
+	static bool isPng(unsigned char *data, int size);
+	static bool readHeader(unsigned char *data, int size, int *width, int *height, bool *supported);
+	static bool read(Config *config, unsigned char *data, int size, int *width, int *height);
+};
+
+#endif /* _PNGREADER_H_INCLUDED */
@@ -0,0 +1,96 @@
+#include "pnmreader.h"
+#include <stdio.h>
+
+static inline unsigned char
+luma(int r, int g, int b)
+{
+	return (unsigned char)(((77 * r) + (150 * g) + (29 * b) + 128) >> 8);
+}
+
+bool
+Pnmreader::isPnm(unsigned char *data, int size)
+{
+	if( size < 2 || data[0] != 'P' ) return false;
+	return data[1] == '2' || data[1] == '3' || data[1] == '5' || data[1] == '6';
+}
+
+//next decimal number, skipping white space and # comments
+bool
+Pnmreader::readNumber(unsigned char *data, int size, int *pos, int *value)
+{
+	int i = *pos;
+	while( i < size ){
+		if( data[i] == '#' ) while( i < size && data[i] != '\n' ) i++;
+		else if( data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n' ) i++;
+		else break;
+	}
+	if( i >= size || data[i] < '0' || data[i] > '9' ) return false;
+	int v = 0;
+	while( i < size && data[i] >= '0' && data[i] <= '9' && v < 100000000 ) v = (v * 10) + (data[i++] - '0');
+	*value = v;
+	*pos = i;
+	return true;
+}
+
+//size and maxval, pos is left on the white space after maxval
+bool
+Pnmreader::readHeader(unsigned char *data, int size, int *width, int *height, int *maxval, int *pos)
+{
+	if( ! isPnm(data, size) ) return false;
+	*pos = 2;
+	return readNumber(data, size, pos, width) && readNumber(data, size, pos, height)
+		&& readNumber(data, size, pos, maxval);
+}
+
+bool
+Pnmreader::read(Config *config, unsigned char *data, int size, int *width, int *height)
+{
+	if( ! isPnm(data, size) ) return false;
+	bool ascii = data[1] == '2' || data[1] == '3';
+	int channels = (data[1] == '3' || data[1] == '6') ? 3 : 1;
+	int pos = 2, w = 0, h = 0, maxval = 0;
+	if( ! readHeader(data, size, &w, &h, &maxval, &pos) ){
+		fprintf(stderr, "PNM Error : bad header\n");
+		return false;
+	}
+	if( (long long) w * h > Config::MAX_IMAGE_PIXELS ){
+		fprintf(stderr, "PNM Error : image too large %dx%d\n", w, h);
+		return false;
+	}
+	if( w <= 0 || h <= 0 || maxval <= 0 || maxval > 65535 ){
+		fprintf(stderr, "PNM Error : unsupported size %dx%d maxval %d\n", w, h, maxval);
+		return false;
+	}
+	int depth = maxval > 255 ? 2 : 1; //bytes per binary sample, most significant first
+	long long samples = (long long)w * h * channels;
+	pos++; //the single white space before binary data
+	if( ascii ? samples > size : pos + (samples * depth) > size ){
+		fprintf(stderr, "PNM Error : truncated image\n");
+		return false;
+	}
+
+	unsigned char *pixbuf = config->newPixbuf(w * h);
+	int c[3] = { 0, 0, 0 };
+	for(int i = 0; i < w * h; i++){
+		for(int k = 0; k < channels; k++){
+			if( ascii ){
+				if( ! readNumber(data, size, &pos, &c[k]) ){
+					fprintf(stderr, "PNM Error : truncated image\n");
+					config->freePixbuf();
+					return false;
+				}
+			}else if( depth == 2 ){
+				c[k] = (data[pos] << 8) | data[pos+1];
+				pos += 2;
+			}else{
+				c[k] = data[pos++];
+			}
+			if( c[k] > maxval ) c[k] = maxval;
+			if( maxval != 255 ) c[k] = ((c[k] * 255) + (maxval / 2)) / maxval;
+		}
+		pixbuf[i] = channels == 3 ? luma(c[0], c[1], c[2]) : (unsigned char) c[0];
+	}
+	*width  = w;
+	*height = h;
+	return true;
+}
@@ -0,0 +1,23 @@
+#ifndef _PNMREADER_H_INCLUDED
+#define _PNMREADER_H_INCLUDED
+
+#include "common.h"
+
+/*
+* Netpbm grey (PGM, P2/P5) and color (PPM, P3/P6) images read straight
+* into the 8 bit grey PIXBUF, color as luma (0.299 R + 0.587 G + 0.114 B)
+* samples above 255 (16 bit maxval) are scaled down to 8 bits
+*/
+class Pnmreader
+{
+
+public:
+	static bool isPnm(unsigned char *data, int size);
+	static bool readHeader(unsigned char *data, int size, int *width, int *height, int *maxval, int *pos);
+	static bool read(Config *config, unsigned char *data, int size, int *width, int *height);
+
+private:
+	static bool readNumber(unsigned char *data, int size, int *pos, int *value);
+};
+
+#endif /* _PNMREADER_H_INCLUDED */
@@ -0,0 +1,194 @@
+#include "probe.h"
+#include <string.h>
+
+Probe::Probe()
+{
+	reset();
+}
+
+void
+Probe::reset()
+{
+	STATUS = PROBE_UNREADABLE;
+	FORMAT = IMAGE_UNKNOWN;
+	WIDTH = 0;
+	HEIGHT = 0;
+	COMPONENTS = 0;
+	PROGRESSIVE = false;
+	ORIENTATION = 1;
+	SCALE_NUM = 8;
+	DECODE_WIDTH = 0;
+	DECODE_HEIGHT = 0;
+	COST = 0;
+}
+
+const char*
+Probe::statusName(int status)
+{
+	switch(status){
+		case PROBE_OK:          return "ok";
+		case PROBE_UNREADABLE:  return "unreadable";
+		case PROBE_TOO_SMALL:   return "too small";
+		case PROBE_UNSUPPORTED: return "unsupported";
+		case PROBE_TOO_LARGE:   return "too large";
+	}
+	return "unknown";
+}
+
+/* 
+* smallest M/8 keeping the longer side >= PIXMAP_SCALE_SIZE, the output is ceil(side*M/8)
+* libjpeg-turbo and libjpeg 7+ do any M, 6b rounds up to 1/8, 1/4, 1/2 or 1/1
+*/
+int
+Probe::jpegScale(Config *config, int width, int height)
+{
+	if( ! config->JPG_SCALE ) return 8; //TODO: Make default remove check after JPEG is stable
+	int boxsize = config->PIXMAP_SCALE_SIZE;
+	if( boxsize <= config->THRESHOLD_WINDOW_SIZE ) return 8;
+	if( width <= boxsize && height <= boxsize ) return 8;
+	int longer = width > height ? width : height;
+	int m = ((8 * boxsize) + longer - 1) / longer;
+	if( m < 1 ) m = 1;
+	return m < 8 ? m : 8;
+}
+
+static int
+exifInt(unsigned char *p, int bytes, bool little)
+{
+	int v = 0;
+	for(int i = 0; i < bytes; i++) v |= p[little ? i : bytes - 1 - i] << (8 * i);
+	return v;
+}
+
+//orientation (0x0112) in IFD0 of the Exif APP1 segment, jpeg_save_markers(JPEG_APP0 + 1) first
+int
+Probe::exifOrientation(j_decompress_ptr cinfo)
+{
+	for(jpeg_saved_marker_ptr m = cinfo->marker_list; m != NULL; m = m->next){
+		if( m->marker != JPEG_APP0 + 1 || m->data_length < 14 ) continue;
+		if( memcmp(m->data, "Exif\0\0", 6) != 0 ) continue;
+		unsigned char *tiff = m->data + 6;
+		int len = (int) m->data_length - 6;
+		bool little = tiff[0] == 'I' && tiff[1] == 'I';
+		if( ! little && !(tiff[0] == 'M' && tiff[1] == 'M') ) return 1;
+		int ifd = exifInt(tiff + 4, 4, little);
+		if( ifd < 8 || ifd + 2 > len ) return 1;
+		int entries = exifInt(tiff + ifd, 2, little);
+		for(int i = 0; i < entries; i++){
+			unsigned char *e = tiff + ifd + 2 + (i * 12);
+			if( e + 12 > tiff + len ) break;
+			if( exifInt(e, 2, little) == 0x0112 ){
+				int v = exifInt(e + 8, 2, little);
+				return v >= 1 && v <= 8 ? v : 1;
+			}
+		}
+		return 1;
+	}
+	return 1;
+}
+
+void
+Probe::readJpegHeader(Config *config, j_decompress_ptr cinfo, int size)
+{
+	reset();
+	FORMAT = IMAGE_JPEG;
+	WIDTH = cinfo->image_width;
+	HEIGHT = cinfo->image_height;
+	COMPONENTS = cinfo->num_components;
+	PROGRESSIVE = cinfo->progressive_mode ? true : false;
+	ORIENTATION = exifOrientation(cinfo);
+	//grey output is only converted from these (no CMYK/YCCK)
+	J_COLOR_SPACE space = cinfo->jpeg_color_space;
+	bool supported = space == JCS_GRAYSCALE || space == JCS_YCbCr || space == JCS_RGB;
+	STATUS = supported ? PROBE_OK : PROBE_UNSUPPORTED;
+	SCALE_NUM = jpegScale(config, WIDTH, HEIGHT);
+	finish(config, PROGRESSIVE ? 2 * (long long) size : size);
+}
+
+int
+Probe::probeJpeg(Config *config, unsigned char *data, int size)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct libjpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = libjpeg_error_exit;
+	if(setjmp(jerr.setjmp_buffer)) {
+		jpeg_destroy_decompress(&cinfo);
+		reset();
+		return STATUS;
+	}
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, data, size);
+	jpeg_save_markers(&cinfo, JPEG_APP0 + 1, 0xffff);
+	(void) jpeg_read_header(&cinfo, TRUE);
+	readJpegHeader(config, &cinfo, size);
+	jpeg_destroy_decompress(&cinfo);
+	return STATUS;
+}
+
+int
+Probe::probe(Config *config, unsigned char *data, int size)
+{
+	reset();
+	if( data == NULL || size < 3 ) return STATUS;
+	if( data[0] == 0xFF && data[1] == 0xD8 ) return probeJpeg(config, data, size);
+
+	bool supported = false;
+	if( Pngreader::readHeader(data, size, &WIDTH, &HEIGHT, &supported) ){
+		FORMAT = IMAGE_PNG;
+		COMPONENTS = 1; //the grey plane, the samples are costed by the file size
+	}else{
+		int maxval = 0, pos = 0;
+		if( ! Pnmreader::readHeader(data, size, &WIDTH, &HEIGHT, &maxval, &pos) ) return STATUS;
+		FORMAT = IMAGE_PNM;
+		COMPONENTS = (data[1] == '3' || data[1] == '6') ? 3 : 1;
+		supported = WIDTH > 0 && HEIGHT > 0 && maxval > 0 && maxval <= 65535;
+	}
+	STATUS = supported ? PROBE_OK : PROBE_UNSUPPORTED;
+	finish(config, FORMAT == IMAGE_PNG ? size + ((long long) WIDTH * HEIGHT) 
+		: (long long) WIDTH * HEIGHT * COMPONENTS);
+	return STATUS;
+}
+
+int
+Probe::probeFile(Config *config, string filename)
+{
+	reset();
+	Mappedfile *mapping = Mappedfile::open(filename);
+	if( mapping != NULL ){
+		probe(config, mapping->getData(), mapping->getSize());
+		mapping->release();
+		return STATUS;
+	}
+	FILE *file = fopen(filename.c_str(), "rb");
+	if( file == NULL ) return STATUS;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if( size > 0 && size <= 0x7fffffff ){
+		unsigned char *data = new unsigned char[size];
+		if( fread(data, 1, size, file) == (size_t) size ) probe(config, data, (int) size);
+		delete [] data;
+	}
+	fclose(file);
+	return STATUS;
+}
+
+void
+Probe::finish(Config *config, long long bytes)
+{
+	if( STATUS == PROBE_OK && (WIDTH <= config->THRESHOLD_WINDOW_SIZE || HEIGHT <= config->THRESHOLD_WINDOW_SIZE) )
+		STATUS = PROBE_TOO_SMALL;
+	DECODE_WIDTH  = (int)((((long long) WIDTH * SCALE_NUM) + 7) / 8);
+	DECODE_HEIGHT = (int)((((long long) HEIGHT * SCALE_NUM) + 7) / 8);
+	if( STATUS == PROBE_OK && (long long) DECODE_WIDTH * DECODE_HEIGHT > Config::MAX_IMAGE_PIXELS )
+		STATUS = PROBE_TOO_LARGE;
+
+	long long decoded = (long long) DECODE_WIDTH * DECODE_HEIGHT;
+	long long thresholded = decoded;
+	int longer = DECODE_WIDTH > DECODE_HEIGHT ? DECODE_WIDTH : DECODE_HEIGHT;
+	int boxsize = config->PIXMAP_SCALE_SIZE;
+	if( longer * 100 > boxsize * (100 + config->PIXMAP_SCALE_FLEX_PERCENT) )
+		thresholded = (decoded * boxsize / longer) * boxsize / longer;
+	COST = bytes + decoded + thresholded;
+}
@@ -0,0 +1,60 @@
+#ifndef _PROBE_H_INCLUDED
+#define _PROBE_H_INCLUDED
+
+#include <string>
+#include "tagimage.h"
+#include "common.h"
+
+#define PROBE_OK          0	//Tagimage can decode it
+#define PROBE_UNREADABLE  1	//not a JPEG, PNG or PNM image, or a corrupt header
+#define PROBE_TOO_SMALL   2	//a side not longer than THRESHOLD_WINDOW_SIZE
+#define PROBE_UNSUPPORTED 3	//CMYK/YCCK JPEG, interlaced PNG, odd PNM maxval
+#define PROBE_TOO_LARGE   4	//more than Config::MAX_IMAGE_PIXELS decoded pixels
+
+#define IMAGE_UNKNOWN 0
+#define IMAGE_JPEG    1
+#define IMAGE_PNG     2
+#define IMAGE_PNM     3
+
+using namespace std;
+
+/*
+* Header only pre-flight of an image: format, size, components, progressive
+* and EXIF orientation, without any IDCT or inflate work. Unusable images
+* are rejected here (STATUS), the JPEG M/8 scale is picked from the header
+* (Tagimage uses the same choice) and COST estimates the decode work so a
+* batch can be ordered by it.
+*
+* COST is relative: compressed bytes (twice for progressive JPEG, the raw
+* sample bytes for PNG/PNM), plus the pixels decoded, plus the pixels
+* thresholded after the rescale to PIXMAP_SCALE_SIZE.
+*/
+class Probe
+{
+
+public:
+	Probe();
+	int  probe(Config *config, unsigned char *data, int size);	//returns STATUS
+	int  probeFile(Config *config, string filename);
+	void readJpegHeader(Config *config, j_decompress_ptr cinfo, int size); //after jpeg_read_header
+	static int  jpegScale(Config *config, int width, int height);	//M of the M/8 JPEG scale, 8 is none
+	static int  exifOrientation(j_decompress_ptr cinfo);	//from the saved APP1 marker, 1 if none
+	static const char* statusName(int status);
+
+	int  STATUS;
+	int  FORMAT;
+	int  WIDTH, HEIGHT;
+	int  COMPONENTS;
+	bool PROGRESSIVE;
+	int  ORIENTATION;	//EXIF 1..8, 1 is upright
+	int  SCALE_NUM;		//JPEG decodes at SCALE_NUM/8
+	int  DECODE_WIDTH, DECODE_HEIGHT;	//Tagimage output size
+	long long COST;
+
+private:
+	void reset();
+	void finish(Config *config, long long bytes);
+	int  probeJpeg(Config *config, unsigned char *data, int size);
+};
+
+#endif /* _PROBE_H_INCLUDED */
@@ -0,0 +1,328 @@
+#include "server.h"
+
+#ifdef DECODE_SERVER
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const int Server::MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+const int Server::QUEUE_SIZE = 64;
+const int Server::MAX_PENDING = 256;
+const int Server::SEND_TIMEOUT = 30;
+
+struct Connection {
+	int fd;
+	int refs;		//reader and writer threads + requests in flight
+	int next_seq;		//sequence for the next request read
+	int next_send;		//sequence of the next response to write
+	map<int, string> ready; //responses completed out of order
+	bool reading;		//reader thread still taking requests
+	bool broken;		//a send failed or timed out, nothing more is sent
+	pthread_mutex_t lock;
+	pthread_cond_t  changed; //a response is ready or sent, or reading stopped
+};
+
+struct Request {
+	Server *server;
+	Connection *connection;
+	int seq;
+	unsigned char *data;
+	int size;
+};
+
+/* c functions and struct for pthread */
+struct reader_data {
+	Server *server;
+	Connection *connection;
+};
+
+void*
+connectionReader(void *arg)
+{
+	struct reader_data *task = (struct reader_data*) arg;
+	task->server->readRequests(task->connection);
+	delete task;
+	return NULL;
+}
+
+void*
+connectionWriter(void *arg)
+{
+	struct reader_data *task = (struct reader_data*) arg;
+	task->server->writeResponses(task->connection);
+	delete task;
+	return NULL;
+}
+
+void
+requestDone(Decoderesult *result)
+{
+	Request *request = (Request*) result->arg;
+	request->server->completeRequest(request, result);
+}
+
+static bool
+readFully(int fd, unsigned char *buffer, int size)
+{
+	int done = 0;
+	while( done < size ){
+		ssize_t n = read(fd, buffer + done, size - done);
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 ) return false;
+		done += (int)n;
+	}
+	return true;
+}
+
+static bool
+writeFully(int fd, const char *buffer, int size)
+{
+	int done = 0;
+	while( done < size ){
+		ssize_t n = send(fd, buffer + done, size - done, MSG_NOSIGNAL);
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 ) return false;
+		done += (int)n;
+	}
+	return true;
+}
+
+Server::Server(int argc, char **argv)
+{
+	decoder  = NULL;
+	listenfd = -1;
+	config   = new Config();
+	config->checkArgs(argc-1, argv+1); //skip -s, socket file takes the image file place
+	socketpath = config->TAG_IMAGE_FILE;
+	config->TAG_IMAGE_FILE = "";
+	workers = config->THREADS > 0 ? config->THREADS : 1;
+}
+
+Server::~Server()
+{
+	if(decoder != NULL) delete decoder; //drains pending requests first
+	if(listenfd >= 0) { 
+		close(listenfd);
+		unlink(socketpath.c_str());
+	}
+	delete config;
+}
+
+bool
+Server::run()
+{
+	if(!config->ARGS_OK) return false;
+
+	struct sockaddr_un addr;
+	if( socketpath.size() >= sizeof(addr.sun_path) ){
+		cerr << "socket path too long: " << socketpath << endl;
+		return false;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketpath.c_str());
+
+	listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if( listenfd < 0 ) { 
+		perror("socket");
+		return false;
+	}
+	unlink(socketpath.c_str()); //stale socket from an earlier run
+	if( bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 
+		|| listen(listenfd, 16) != 0 ){
+		perror(socketpath.c_str());
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	decoder = new Asyncdecoder(config, workers, QUEUE_SIZE);
+	if(config->DEBUG) cout << "serving on " << socketpath << " workers=" << workers 
+		<< " queue=" << QUEUE_SIZE << endl;
+
+	for(;;){
+		int fd = accept(listenfd, NULL, NULL);
+		if( fd < 0 ){
+			if( errno == EINTR || errno == ECONNABORTED ) continue;
+			perror("accept");
+			return false;
+		}
+		struct timeval timeout;
+		timeout.tv_sec  = SEND_TIMEOUT;
+		timeout.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		Connection *connection = new Connection;
+		connection->fd = fd;
+		connection->refs = 2;
+		connection->next_seq = 0;
+		connection->next_send = 0;
+		connection->reading = true;
+		connection->broken = false;
+		pthread_mutex_init(&connection->lock, NULL);
+		pthread_cond_init(&connection->changed, NULL);
+
+		if( ! startThread(connectionWriter, connection) ){
+			shutdown(fd, SHUT_RDWR); //the reader finds the connection closed
+			releaseConnection(connection);
+		}
+		if( ! startThread(connectionReader, connection) ){
+			pthread_mutex_lock(&connection->lock);
+			connection->reading = false;
+			pthread_cond_broadcast(&connection->changed);
+			pthread_mutex_unlock(&connection->lock);
+			releaseConnection(connection);
+		}
+	}
+	return true;
+}
+
+bool
+Server::startThread(void *(*body)(void *), Connection *connection)
+{
+	struct reader_data *task = new reader_data;
+	task->server = this;
+	task->connection = connection;
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	bool started = pthread_create(&thread, &attr, body, (void *)task) == 0;
+	pthread_attr_destroy(&attr);
+	if( ! started ) delete task;
+	return started;
+}
+
+void
+Server::readRequests(Connection *connection)
+{
+	unsigned char header[4];
+	while( readFully(connection->fd, header, 4) ){
+		unsigned int size = ((unsigned int)header[0] << 24) | ((unsigned int)header[1] << 16) 
+			| ((unsigned int)header[2] << 8) | (unsigned int)header[3];
+		if( size == 0 ) break;
+		if( size > (unsigned int)MAX_REQUEST_SIZE ){
+			cerr << "request too large: " << size << endl;
+			break;
+		}
+		Request *request = new Request;
+		request->server = this;
+		request->connection = connection;
+		request->size = (int)size;
+		request->data = new unsigned char[size];
+		if( ! readFully(connection->fd, request->data, request->size) ){
+			delete [] request->data;
+			delete request;
+			break;
+		}
+		pthread_mutex_lock(&connection->lock);
+		//a client not reading its responses stops being read
+		while( connection->next_seq - connection->next_send >= MAX_PENDING && ! connection->broken )
+			pthread_cond_wait(&connection->changed, &connection->lock);
+		bool broken = connection->broken;
+		request->seq = connection->next_seq++;
+		connection->refs++;
+		pthread_mutex_unlock(&connection->lock);
+		if( broken ){
+			delete [] request->data;
+			delete request;
+			releaseConnection(connection);
+			break;
+		}
+
+		//blocks while queue is full
+		if( decoder->submit(request->data, request->size, requestDone, (void *)request, 0) < 0 ){
+			delete [] request->data;
+			delete request;
+			releaseConnection(connection);
+			break;
+		}
+	}
+	shutdown(connection->fd, SHUT_RD);
+	pthread_mutex_lock(&connection->lock);
+	connection->reading = false;
+	pthread_cond_broadcast(&connection->changed);
+	pthread_mutex_unlock(&connection->lock);
+	releaseConnection(connection);
+}
+
+/* 
+* sends the responses in request order, the only thread writing the socket 
+* ends once the reader stopped and every request read was answered, 
+* or when a send fails (SEND_TIMEOUT) 
+*/
+void
+Server::writeResponses(Connection *connection)
+{
+	pthread_mutex_lock(&connection->lock);
+	for(;;){
+		map<int, string>::iterator it = connection->ready.find(connection->next_send);
+		if( it == connection->ready.end() ){
+			if( ! connection->reading && connection->next_send == connection->next_seq ) break;
+			pthread_cond_wait(&connection->changed, &connection->lock);
+			continue;
+		}
+		string response = it->second;
+		connection->ready.erase(it);
+		pthread_mutex_unlock(&connection->lock);
+		bool sent = writeFully(connection->fd, response.data(), (int)response.size());
+		pthread_mutex_lock(&connection->lock);
+		if( ! sent ){
+			connection->broken = true;
+			shutdown(connection->fd, SHUT_RDWR); //wakes the reader
+			pthread_cond_broadcast(&connection->changed);
+			break;
+		}
+		connection->next_send++;
+		pthread_cond_broadcast(&connection->changed);
+	}
+	pthread_mutex_unlock(&connection->lock);
+	releaseConnection(connection);
+}
+
+void
+Server::completeRequest(Request *request, Decoderesult *result)
+{
+	bool ok = result->status == DECODE_OK || result->status == DECODE_NOTFOUND;
+	char response[13];
+	for(int i = 0; i < 12; i++) 
+		response[i] = (ok && result->tag[i] >= 0 && result->tag[i] <= 9) ? (char)('0' + result->tag[i]) : '-';
+	response[12] = '\n';
+
+	delete [] request->data;
+	sendResponse(request->connection, request->seq, string(response, 13));
+	releaseConnection(request->connection);
+	delete request;
+}
+
+/* 
+* runs on a decode worker: the response is only queued for the writer 
+* thread, a client slow to read never holds up a worker 
+*/
+void
+Server::sendResponse(Connection *connection, int seq, string response)
+{
+	pthread_mutex_lock(&connection->lock);
+	if( ! connection->broken ) connection->ready[seq] = response;
+	pthread_cond_broadcast(&connection->changed);
+	pthread_mutex_unlock(&connection->lock);
+}
+
+void
+Server::releaseConnection(Connection *connection)
+{
+	pthread_mutex_lock(&connection->lock);
+	int refs = --connection->refs;
+	pthread_mutex_unlock(&connection->lock);
+	if( refs > 0 ) return;
+	close(connection->fd);
+	pthread_cond_destroy(&connection->changed);
+	pthread_mutex_destroy(&connection->lock);
+	delete connection;
+}
+
+#endif /* DECODE_SERVER */
@@ -0,0 +1,68 @@
+#ifndef _SERVER_H_INCLUDED
+#define _SERVER_H_INCLUDED
+
+#include <string>
+#include <map>
+
+#include "asyncdecoder.h"
+#include "common.h"
+
+#if defined(PTHREAD) && !defined(_WIN32)
+#define DECODE_SERVER
+#endif
+
+#ifdef DECODE_SERVER
+
+using namespace std;
+
+/*
+* Long running decoder on a unix domain socket (decode -s socketfile ...)
+*
+* Request  : 4 byte big endian length followed by that many bytes of jpeg 
+*            a zero length request closes the connection 
+* Response : 13 bytes, the 12 tag digits and a newline 
+*            '-' for every digit that could not be decoded 
+*
+* Requests can be pipelined on a connection, responses come back in request 
+* order. Each connection has a reader and a writer thread, decoding is done 
+* by an Asyncdecoder with THREADS workers. The queue in between is bounded, 
+* a full queue stops the readers (back-pressure). The workers only queue the 
+* responses, a client not reading them stalls its own writer and, after 
+* MAX_PENDING unsent responses, its own reader; the connection is dropped 
+* when a send blocks for SEND_TIMEOUT seconds.
+*/
+
+struct Connection;
+struct Request;
+
+class Server
+{
+
+public:
+	Server(int argc, char **argv);	//same options as the decoder, socket file in place of the image
+	~Server();
+	bool run();			//accept and serve connections, returns only on error
+	void readRequests(Connection *connection);	//connection reader thread body
+	void writeResponses(Connection *connection);	//connection writer thread body
+	void completeRequest(Request *request, Decoderesult *result); //decode callback
+
+	static const int MAX_REQUEST_SIZE;
+	static const int QUEUE_SIZE;
+	static const int MAX_PENDING;	//responses not yet sent before a connection stops reading requests
+	static const int SEND_TIMEOUT;	//seconds
+
+private:
+	Config       *config;
+	Asyncdecoder *decoder;
+	string socketpath;
+	int    listenfd;
+	int    workers;
+
+	void sendResponse(Connection *connection, int seq, string response);
+	void releaseConnection(Connection *connection);
+	bool startThread(void *(*body)(void *), Connection *connection);
+};
+
+#endif /* DECODE_SERVER */
+
+#endif /* _SERVER_H_INCLUDED */
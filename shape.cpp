@@ -18,12 +18,66 @@ Shape::Shape(Config *_config)
 
 Shape::~Shape()
 {
-	if(widths_at_y != NULL)    delete [] widths_at_y;
-	if(heights_at_x != NULL)   delete [] heights_at_x;
-	if(midpoints_at_y != NULL) delete [] midpoints_at_y;
-	if(midpoints_at_x != NULL) delete [] midpoints_at_x;
-	if(xmap != NULL)           delete [] xmap;
-	if(ymap != NULL)           delete [] ymap;
+	freeWidths();
+	freeHeights();
+	freeMaps();
+}
+
+/* 
+* the map and width/height arrays are the only big Shape buffers, 
+* allocated here so Config::MEMORY_STATS can account them 
+*/
+void
+Shape::freeMaps()
+{
+	if(xmap == NULL) return;
+	delete [] xmap;
+	delete [] ymap;
+	xmap = NULL;
+	ymap = NULL;
+	if(config != NULL) config->trackFree(2 * (long long)mapcount * sizeof(int));
+}
+
+void
+Shape::freeWidths()
+{
+	if(widths_at_y == NULL) return;
+	delete [] widths_at_y;
+	delete [] midpoints_at_y;
+	widths_at_y = NULL;
+	midpoints_at_y = NULL;
+	if(config != NULL) config->trackFree(2 * (long long)wcount * sizeof(int));
+}
+
+void
+Shape::freeHeights()
+{
+	if(heights_at_x == NULL) return;
+	delete [] heights_at_x;
+	delete [] midpoints_at_x;
+	heights_at_x = NULL;
+	midpoints_at_x = NULL;
+	if(config != NULL) config->trackFree(2 * (long long)hcount * sizeof(int));
+}
+
+void
+Shape::newWidths(int count)
+{
+	freeWidths();
+	wcount = count;
+	widths_at_y = new int[count];
+	midpoints_at_y = new int[count];
+	if(config != NULL) config->trackAlloc(2 * (long long)count * sizeof(int));
+}
+
+void
+Shape::newHeights(int count)
+{
+	freeHeights();
+	hcount = count;
+	heights_at_x = new int[count];
+	midpoints_at_x = new int[count];
+	if(config != NULL) config->trackAlloc(2 * (long long)count * sizeof(int));
 }
 
 void
@@ -40,18 +94,25 @@ Shape::init()
 	mapcount = 0;
 
 	rotated  = false;  
+	confidence = 0;
 	d_pixmap = NULL;
+#ifndef PRODUCTION
 	debug    = false;
 	pixdebug = false;
 	anchordebug = false;
+#endif
 	widths_at_y = NULL;
 	heights_at_x = NULL;
 	midpoints_at_y = NULL;
 	midpoints_at_x = NULL;
+	wcount = 0;
+	hcount = 0;
 	if(config != NULL){
+#ifndef PRODUCTION
 		debug       = config->DEBUG;
 		pixdebug    = config->CHECK_VISUAL_DEBUG();
 		anchordebug = config->ANCHOR_DEBUG;
+#endif
 		grid_w = config->GRID_WIDTH;
 		grid_h = config->GRID_HEIGHT;
 	}
@@ -64,9 +125,11 @@ void
 Shape::setConfig(Config *_config)
 {
 	config = _config;
+#ifndef PRODUCTION
 	debug       = config->DEBUG;
 	pixdebug    = config->CHECK_VISUAL_DEBUG();
 	anchordebug = config->ANCHOR_DEBUG;
+#endif
 	grid_w = config->GRID_WIDTH;
 	grid_h = config->GRID_HEIGHT;
 }
@@ -100,15 +163,15 @@ Shape::setCenter(int x, int y)
 void 
 Shape::setValues(vector<int> _xmap, vector<int> _ymap, int _mapcount)
 {
+	freeMaps();
 	mapcount = _mapcount;
 
 	assert( mapcount == (int) _xmap.size() );
 	assert( mapcount == (int) _ymap.size() );
 
-	if(xmap != NULL) delete [] xmap;
-	if(ymap != NULL) delete [] ymap;
 	xmap = new int[mapcount];
 	ymap = new int[mapcount];
+	if(config != NULL) config->trackAlloc(2 * (long long)mapcount * sizeof(int));
 
 	for(int i=0; i< mapcount; i++) xmap[i] = _xmap[i];
 	for(int i=0; i< mapcount; i++) ymap[i] = _ymap[i];
@@ -117,11 +180,11 @@ Shape::setValues(vector<int> _xmap, vector<int> _ymap, int _mapcount)
 void 
 Shape::copyValues(int* _xmap, int* _ymap, int _mapcount)
 {
+	freeMaps();
 	mapcount = _mapcount;
-	if(xmap != NULL) delete [] xmap;
-	if(ymap != NULL) delete [] ymap;
 	xmap = new int[mapcount];
 	ymap = new int[mapcount];
+	if(config != NULL) config->trackAlloc(2 * (long long)mapcount * sizeof(int));
 
 	int i = 0;
 	while(i < mapcount){
@@ -131,6 +194,21 @@ Shape::copyValues(int* _xmap, int* _ymap, int _mapcount)
 	}
 }
 
+//pixel map, bounds and widths/heights, the config stays
+void
+Shape::copyShape(Shape *shape)
+{
+	int mnx = shape->getminx();
+	int mny = shape->getminy();
+	int mxx = shape->getmaxx();
+	int mxy = shape->getmaxy();
+	copyValues(shape->getxmap(), shape->getymap(), shape->getmapcount());
+	setBounds(mnx, mny, mxx, mxy);
+	setCenter( mnx + (mxx - mnx)/2, mny + (mxy - mny)/2 );
+	copyWidthValues(shape->getWidthValues(), shape->getWMidpointValues(), mny, mxy);
+	copyHeightValues(shape->getHeightValues(), shape->getHMidpointValues(), mnx, mxx);
+}
+
 int*
 Shape::getWidthValues()
 {
@@ -158,10 +236,7 @@ Shape::getWMidpointValues()
 void 
 Shape::copyHeightValues(int *heights, int *mids, int min, int max)
 {
-	if( heights_at_x != NULL ) { delete [] heights_at_x; heights_at_x = NULL;}
-	if( midpoints_at_x != NULL ) { delete [] midpoints_at_x; midpoints_at_x = NULL;}
-	heights_at_x = new int[max-min];
-	midpoints_at_x = new int[max-min];
+	newHeights(max-min);
 
 	int c = 0;
 	for(int i=min; i<max; i++) { 
@@ -174,10 +249,7 @@ Shape::copyHeightValues(int *heights, int *mids, int min, int max)
 void 
 Shape::copyWidthValues(int *widths, int *mids, int min, int max)
 {
-	if( widths_at_y != NULL ) { delete [] widths_at_y; widths_at_y = NULL; }
-	if( midpoints_at_y != NULL ) { delete [] midpoints_at_y; midpoints_at_y = NULL; }
-	widths_at_y = new int[max-min];
-	midpoints_at_y = new int[max-min];
+	newWidths(max-min);
 
 	int c = 0;
 	for(int i=min; i<max; i++) { 
@@ -190,10 +262,7 @@ Shape::copyWidthValues(int *widths, int *mids, int min, int max)
 void 
 Shape::setHeightValues(int *heights_holder, int* mids_holder, int min, int max, bool reset)
 {
-	if( heights_at_x != NULL ) { delete [] heights_at_x; heights_at_x = NULL;}
-	if( midpoints_at_x != NULL ) { delete [] midpoints_at_x; midpoints_at_x = NULL;}
-	heights_at_x = new int[max-min];
-	midpoints_at_x = new int[max-min];
+	newHeights(max-min);
 
 	int c = 0;
 	for(int i=min; i<max; i++) {
@@ -209,10 +278,7 @@ Shape::setHeightValues(int *heights_holder, int* mids_holder, int min, int max,
 void 
 Shape::setWidthValues(int *widths_holder, int* mids_holder, int min, int max, bool reset)
 {
-	if( widths_at_y != NULL ) { delete [] widths_at_y; widths_at_y = NULL; }
-	if( midpoints_at_y != NULL ) { delete [] midpoints_at_y; midpoints_at_y = NULL; }
-	widths_at_y = new int[max-min];
-	midpoints_at_y = new int[max-min];
+	newWidths(max-min);
 
 	int c = 0;
 	for(int i=min; i<max; i++) {
@@ -457,11 +523,17 @@ Shape::rotateShape(int x, int y, int dx, int dy, int d)
 	setCenter(min_x + (max_x - min_x)/2,  min_y + (max_y - min_y)/2);
 }
 
+/* 
+* confidence is the smallest margin of the width and midpoint tests made, 
+* bars tests included when it falls through to the box match 
+*/
 int
 Shape::matchPattern()
 {
+	confidence = 100;
 	int result = matchBars();
 	if( result == -1 )  result =  matchBox();
+	if( result == -1 )  confidence = 0;
 	if(debug) { result == -1 ?  cout << " F" << endl : cout << " OK" << endl ;  }
 	if(pixdebug) d_pixmap->markPoint( center_x, center_y, 2);
 	return result;
@@ -507,8 +579,11 @@ Shape::matchBars()
 
 	int tw = widthAt(min_y + hd, 4);
 	int tm = midpoint;
+	lowerConfidence(equalMargin(tw, w));
 	if( ! isEqual(tw, w) ) {	 //only if not very wide 
+		lowerConfidence(equalMargin(center_x, tm));
 		if(isEqual(center_x, tm) ){ 	 //and is at middle
+			lowerConfidence(limitMargin(tw, w/3, w/3));
 			if ( tw <= w/3 ){//and is thin
 				TOP_R = true;
 				TOP_L = true;
@@ -518,8 +593,11 @@ Shape::matchBars()
 
 	int bw = widthAt(max_y - hd, 4);
 	int bm = midpoint;
+	lowerConfidence(equalMargin(bw, w));
 	if( ! isEqual(bw, w) ) {	  //only if not wide 
+		lowerConfidence(equalMargin(center_x, bm));
 		if(isEqual(center_x, bm) ){  	  //and is at middle	
+			lowerConfidence(limitMargin(bw, w/3, w/3));
 			if ( bw <= w/3 ){ //and is thin
 				BOT_R = true;
 				BOT_L = true;
@@ -576,14 +654,18 @@ Shape::matchBox()
 
 	int tw = widthAt(min_y + hd, 4);
 	int tm = midpoint;
+	lowerConfidence(equalMargin(tw, w));
 	if( ! isEqual(tw, w)) {		//if top not full wide as shape
+		lowerConfidence(limitMargin(tm, center_x, w/4));
 		if(tm > center_x ) TOP_R = true;	//if top center on right of shape center
 		else   	     TOP_L = true;	//if top center on left of shape center
 	}
 
 	int bw = widthAt(max_y - hd, 4);
 	int bm = midpoint;
+	lowerConfidence(equalMargin(bw, w));
 	if( ! isEqual(bw, w) ) {		//if bottom not full wide as ahape
+		lowerConfidence(limitMargin(bm, center_x, w/4));
 		if(bm > center_x ) BOT_R = true;	//if bottom center on right of shape center
 		else	     BOT_L = true;	//if bottom center on left of shape center
 	}
@@ -647,6 +729,7 @@ Shape::isAnchorLike()
 	if(l == 0) return false;
 	int upperlimit = (grid_w > grid_h) ?  (grid_w * 3) : (grid_h * 3) ;
 	int lowerlimit = upperlimit / 8;
+	if(config->MULTIPLE_TAGS && config->TAGS_PER_SIDE > 1) lowerlimit /= config->TAGS_PER_SIDE; //smaller tags
 	if(anchordebug) cout << l << " " << upperlimit << " " << lowerlimit << endl;
 	if(anchordebug) cout << "isAnchorLike : limit=" << upperlimit << " length=" << l << endl;
 	if(l > upperlimit) return false;
@@ -868,6 +951,38 @@ Shape::isEqualByPixelThreshold(int a, int b, int threshold)
 	return false;
 }
 
+int
+Shape::getConfidence()
+{
+	return confidence;
+}
+
+//how far a and b are from the isEqual() threshold, 0 on it .. 100 at (or over) the threshold away
+int
+Shape::equalMargin(int a, int b)
+{
+	int bigger = a > b ? a : b;
+	int threshold = (int) ((float)bigger * ((float)config->SHAPE_BOX_FLEX_PERCENT / 100.0));
+	if( threshold <= 0 ) return 100;
+	int margin = (abs(abs(a-b) - threshold) * 100) / threshold;
+	return margin > 100 ? 100 : margin;
+}
+
+//how far value is from limit, 0 on it .. 100 at scale away
+int
+Shape::limitMargin(int value, int limit, int scale)
+{
+	if( scale <= 0 ) return 100;
+	int margin = (abs(value - limit) * 100) / scale;
+	return margin > 100 ? 100 : margin;
+}
+
+void
+Shape::lowerConfidence(int margin)
+{
+	if( margin < confidence ) confidence = margin;
+}
+
 bool
 Shape::isEqual(int a, int b)
 {
@@ -36,6 +36,7 @@ public:
 	void setGrid(int w, int h);
 	void setValues(vector<int> xmap, vector<int> ymap, int mapcount);
 	void copyValues(int *xmap, int *ymap, int mapcount);
+	void copyShape(Shape *shape);
 	void setWidthValues(int *widths_holder, int *mids, int min, int max, bool reset);
 	void setHeightValues(int *heights_holder, int *mids, int min, int max, bool reset);
 	void copyWidthValues(int *widths, int *mids, int min, int max);
@@ -48,6 +49,7 @@ public:
 	int* getxmap();
 	int  getmapcount();
 	int  matchPattern();
+	int  getConfidence();	//of the last matchPattern(), 0 on a threshold .. 100 far from all
 	void setConfig(Config *config);
 	//bounding box based sizes
 	int  size();
@@ -108,14 +110,21 @@ private:
 	int *heights_at_x;
 	int *midpoints_at_y;
 	int *midpoints_at_x;
+	int  wcount, hcount;	//sizes of the *_at_y and *_at_x arrays
 	bool rotated; 
 	int  width, height;
 	int  min_x, max_x, min_y, max_y;
 	int  center_x, center_y;
 	int  grid_w, grid_h; 
 	int  midpoint;
+	int  confidence;
 
 	void init();
+	void freeMaps();
+	void freeWidths();
+	void freeHeights();
+	void newWidths(int count);
+	void newHeights(int count);
 	int  matchBox();
 	int  matchBars();
 	int  findAngle(int x1, int y1, int x2, int y2);
@@ -132,12 +141,21 @@ private:
 	int  midxAt(int y);
 	int  midyAt(int x);
 	bool isEqual(int a, int b);
+	int  equalMargin(int a, int b);
+	int  limitMargin(int value, int limit, int scale);
+	void lowerConfidence(int margin);
 	bool isEqualByPixelThreshold(int a, int b, int threshold);
 
 	//debug only
+#ifdef PRODUCTION
+	static const bool debug = false;
+	static const bool pixdebug = false;
+	static const bool anchordebug = false;
+#else
 	bool debug;
 	bool pixdebug;
 	bool anchordebug;
+#endif
 	Pixmap *d_pixmap; 
 
 	void d_debugMatchBars(int tw, int tm, int bw, int bm);
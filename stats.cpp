@@ -0,0 +1,89 @@
+#include "stats.h"
+
+Stats::Stats()
+{
+	reset();
+}
+
+void
+Stats::reset()
+{
+	jpeg_decode = 0;
+	scaling     = 0;
+	threshold   = 0;
+	edgemark    = 0;
+	border      = 0;
+	anchor      = 0;
+	tilt        = 0;
+	pattern     = 0;
+	retry       = 0;
+	total       = 0;
+
+	shapes_traced       = 0;
+	shapes_kept         = 0;
+	anchor_candidates   = 0;
+	orientation_retries = 0;
+	threshold_retries   = 0;
+	tracked             = 0;
+
+	for(int i = 0; i < MEM_STAGES; i++){
+		mem_bytes[i]  = 0;
+		mem_allocs[i] = 0;
+		mem_peak[i]   = 0;
+	}
+	mem_live       = 0;
+	mem_peak_total = 0;
+	mem_stage      = MEM_IMAGE;
+}
+
+void
+Stats::memStage(int stage)
+{
+	mem_stage = stage;
+	if( mem_live > mem_peak[mem_stage] ) mem_peak[mem_stage] = mem_live;
+}
+
+void
+Stats::memAlloc(long long bytes)
+{
+	mem_bytes[mem_stage] += bytes;
+	mem_allocs[mem_stage]++;
+	mem_live += bytes;
+	if( mem_live > mem_peak[mem_stage] ) mem_peak[mem_stage] = mem_live;
+	if( mem_live > mem_peak_total ) mem_peak_total = mem_live;
+}
+
+void
+Stats::memFree(long long bytes)
+{
+	mem_live -= bytes;
+}
+
+void
+Stats::print()
+{
+	cout << "jpeg="      << jpeg_decode 
+		<< " scale="     << scaling 
+		<< " threshold=" << threshold 
+		<< " edgemark="  << edgemark 
+		<< " border="    << border 
+		<< " anchor="    << anchor 
+		<< " tilt="      << tilt 
+		<< " pattern="   << pattern 
+		<< " retry="     << retry 
+		<< " total="     << total << " usecs" << endl;
+	cout << "traced="    << shapes_traced 
+		<< " kept="      << shapes_kept 
+		<< " anchors="   << anchor_candidates 
+		<< " retries="   << orientation_retries 
+		<< " offsets="   << threshold_retries 
+		<< " tracked="   << tracked << endl;
+	if( mem_peak_total == 0 ) return; //accounting off
+	static const char *names[MEM_STAGES] = { "image", "threshold", "border", "pattern" };
+	for(int i = 0; i < MEM_STAGES; i++){
+		cout << names[i] << ": bytes=" << mem_bytes[i] 
+			<< " allocs=" << mem_allocs[i] 
+			<< " peak=" << mem_peak[i] << endl;
+	}
+	cout << "peak=" << mem_peak_total << " live=" << mem_live << " bytes" << endl;
+}
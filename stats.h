@@ -0,0 +1,63 @@
+#ifndef _STATS_H_INCLUDED
+#define _STATS_H_INCLUDED
+
+#include <iostream>
+
+using namespace std;
+
+/* 
+* per stage timings (microseconds, Timer::now()) and counts of one decode 
+* filled in by Decoder and the stages, read back with Decoder::copyStats() 
+*
+* threshold includes the edge marking when it is done in the same loop 
+* (single thread), edgemark is only the separate pass (multi thread) 
+*
+* memory accounting (Config::MEMORY_STATS) covers the big buffers only: 
+* PIXBUF, EDGE_MAP, the Threshold work arrays, Border holders and Shape maps 
+* an allocation is charged to the stage running when it is made 
+*/
+
+#define MEM_IMAGE     0	//Tagimage 
+#define MEM_THRESHOLD 1	//Threshold 
+#define MEM_BORDER    2	//Border tracing, anchor search 
+#define MEM_PATTERN   3	//Pattern tilt, rotation and matching 
+#define MEM_STAGES    4
+
+class Stats
+{
+
+public:
+	Stats();
+	void reset();
+	void print();
+	void memStage(int stage);		//following allocations are charged to this stage 
+	void memAlloc(long long bytes);
+	void memFree(long long bytes);
+
+	long long jpeg_decode;		//Tagimage, includes JPG_SCALE done in the IDCT 
+	long long scaling;		//Threshold setup and any resampling 
+	long long threshold;		//adaptive thresholding (and fused edge marking)
+	long long edgemark;		//separate edge marking pass 
+	long long border;		//Border edge tracing and shape filtering 
+	long long anchor;		//Border anchor search after tracing 
+	long long tilt;			//Pattern tilt detection and shape rotation 
+	long long pattern;		//Pattern group search and block matching 
+	long long retry;		//edge maps for the threshold retries, from the kept window means 
+	long long total;		//whole processTag() 
+
+	int shapes_traced;		//edges traced by Border 
+	int shapes_kept;		//shapes passing the size filter 
+	int anchor_candidates;		//anchor like shapes collected 
+	int orientation_retries;	//anchor positions tried after the first guess 
+	int threshold_retries;		//retry edge maps traced after the first (THRESHOLD_RETRIES) 
+	int tracked;			//stream mode: found in the tracking window, no full frame search 
+
+	long long mem_bytes[MEM_STAGES];	//bytes allocated in each stage 
+	int  mem_allocs[MEM_STAGES];		//allocations in each stage 
+	long long mem_peak[MEM_STAGES];	//peak live bytes (all stages) while in each stage 
+	long long mem_live;			//live bytes now, back to 0 after a decode 
+	long long mem_peak_total;		//peak live bytes of the whole decode 
+	int  mem_stage;
+};
+
+#endif /* _STATS_H_INCLUDED */
@@ -1,9 +1,10 @@
 #include "tagimage.h"
+#include "probe.h"
 
 void libjpeg_error_exit(j_common_ptr cinfo) {
     fprintf(stderr, "JPEG Error : " );
     (*cinfo->err->output_message) (cinfo);
-    exit(1);
+    longjmp(((struct libjpeg_error_mgr *)cinfo->err)->setjmp_buffer, 1);
 }
 
 const int Tagimage::MAXRGB = 256;
@@ -13,28 +14,87 @@ Tagimage::Tagimage(Config *_config)
     valid = false;
     COLORS = 1;
     config = _config;
+    plane = NULL;
+    stride = 0;
+    wrapped = false;
+    config->IMAGE_ORIENTATION = 1;
 
-	struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    FILE * infile;
-    JSAMPARRAY buffer;
-    int row_stride;
-
-    //if ((infile = fopen(config->TAG_IMAGE_FILE.c_str(), "rb")) == NULL) {
-    infile = fopen(config->TAG_IMAGE_FILE.c_str(), "rb");
-	if( infile == NULL ){
-        fprintf(stderr, "can't open file\n");
-        exit(1);
+    FILE * infile = NULL;
+    Mappedfile *mapping = NULL;
+    unsigned char *data = config->TAG_IMAGE_DATA; //in memory image has precedence over file
+    int size = config->TAG_IMAGE_DATA_SIZE;
+
+    if(data == NULL && config->TAG_IMAGE_MMAP){ //file read in place, NULL falls back to stdio
+        mapping = Mappedfile::open(config->TAG_IMAGE_FILE);
+        if(mapping != NULL){
+            data = mapping->getData();
+            size = mapping->getSize();
+        }
     }
 
-    cinfo.err = jpeg_std_error(&jerr);
-    jerr.error_exit = libjpeg_error_exit;
+    if(data == NULL){
+        //if ((infile = fopen(config->TAG_IMAGE_FILE.c_str(), "rb")) == NULL) {
+        infile = fopen(config->TAG_IMAGE_FILE.c_str(), "rb");
+        if( infile == NULL ){
+            fprintf(stderr, "can't open file\n");
+            return;
+        }
+        //PNG and PNM are read whole from memory, JPEG streams from the file
+        unsigned char head[8];
+        int n = (int) fread(head, 1, sizeof(head), infile);
+        rewind(infile);
+        if( Pngreader::isPng(head, n) || Pnmreader::isPnm(head, n) ){
+            int filesize = 0;
+            unsigned char *filedata = readFile(infile, &filesize);
+            fclose(infile);
+            if(filedata != NULL) readNative(filedata, filesize);
+            delete [] filedata;
+            return;
+        }
+    }else if( readNative(data, size) ){
+        if(mapping != NULL) mapping->release();
+        return;
+    }
+
+    readJpeg(infile, data, size);
+    if(infile != NULL) fclose(infile);
+    if(mapping != NULL) mapping->release();
+}
+
+/* the libjpeg decode of the file or the memory image, in its own frame so 
+ * nothing it longjmp()s back to is changed after setjmp(), the caller 
+ * closes the file and releases the mapping */
+void
+Tagimage::readJpeg(FILE *infile, unsigned char *data, int size)
+{
+	struct jpeg_decompress_struct cinfo;
+    struct libjpeg_error_mgr jerr;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = libjpeg_error_exit;
+    if(setjmp(jerr.setjmp_buffer)) { //corrupt image, clean up and stay invalid
+        jpeg_destroy_decompress(&cinfo);
+        config->freePixbuf();
+        return;
+    }
 
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, infile);
+    if(infile != NULL) jpeg_stdio_src(&cinfo, infile);
+    else jpeg_mem_src(&cinfo, data, size);
 
+    jpeg_save_markers(&cinfo, JPEG_APP0 + 1, 0xffff); //Exif
     (void) jpeg_read_header(&cinfo, TRUE);
 
+    //reject before any IDCT work, and the M/8 scale from the header
+    Probe probe;
+    probe.readJpegHeader(config, &cinfo, size);
+    if( probe.STATUS != PROBE_OK ){
+        fprintf(stderr, "JPEG Error : %s image %dx%d\n", Probe::statusName(probe.STATUS), probe.WIDTH, probe.HEIGHT);
+        jpeg_destroy_decompress(&cinfo);
+        return;
+    }
+    config->IMAGE_ORIENTATION = probe.ORIENTATION; //stored pixels stay as they are, Pattern takes the hint
+
     cinfo.dct_method = JDCT_FASTEST;
     cinfo.do_fancy_upsampling = false;
     cinfo.output_components = 1;
@@ -44,28 +104,9 @@ Tagimage::Tagimage(Config *_config)
 	cinfo.out_color_space = JCS_RGB; 
 	*/
 
-    width  = cinfo.image_width;
-    height = cinfo.image_height;
-
-    if(config->JPG_SCALE){ //TODO: Make default remove check after JPEG is stable
-		int boxsize = config->PIXMAP_SCALE_SIZE;
-		if( boxsize > config->THRESHOLD_WINDOW_SIZE ) {
-			if(  width > boxsize || height > boxsize ){
-				float scale = width > height ? (float)width/(float)boxsize  :  (float)height/(float)boxsize ;
-				int n_width = (int)((float)width/scale);
-				int n_height = (int)((float)height/scale);
-				if( (width / 8) >= n_width && (height / 8) >= n_height ){
-					cinfo.scale_num = 1;
-					cinfo.scale_denom = 8;
-				}else if((width / 4) >= n_width && (height / 4 >= n_height ) ){
-					cinfo.scale_num = 1;
-					cinfo.scale_denom = 4;
-				}else if((width / 2) >= n_width && (height / 2 >= n_height ) ){
-					cinfo.scale_num = 1;
-					cinfo.scale_denom = 2;
-				}
-		  	}
-		} 
+    if( probe.SCALE_NUM < 8 ){
+        cinfo.scale_num = probe.SCALE_NUM;
+        cinfo.scale_denom = 8;
     }
 
     jpeg_calc_output_dimensions(&cinfo);
@@ -73,59 +114,174 @@ Tagimage::Tagimage(Config *_config)
     width  = cinfo.output_width;
     height = cinfo.output_height;
 
-    (void) jpeg_start_decompress(&cinfo);
+    //luma only: Y plane IDCT output without color conversion, chroma never decoded
+    bool raw = config->JPG_RAW_LUMA && canReadRawLuma(&cinfo);
+    if( raw ){
+        cinfo.raw_data_out = TRUE;
+        for(int ci = 1; ci < cinfo.num_components; ci++) cinfo.comp_info[ci].component_needed = FALSE;
+    }
 
-    assert(cinfo.output_components == cinfo.out_color_components); //dont support colormapped jpeg
+    (void) jpeg_start_decompress(&cinfo);
 
-    row_stride   = cinfo.output_width * cinfo.output_components;
     width  =  cinfo.output_width;
     height = cinfo.output_height;
 
-    buffer = (*cinfo.mem->alloc_sarray)
-    ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
+    config->newPixbuf(width * height);
 
-    config->PIXBUF = new unsigned char[width * height];
-
-    while (cinfo.output_scanline < cinfo.output_height) {
-        (void) jpeg_read_scanlines(&cinfo, buffer, 1);
-        (void) processScanLine(buffer[0], cinfo.output_width );
-    }
+    if( raw ) readRawLuma(&cinfo);
+    else readScanlines(&cinfo);
 
     (void) jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
-    fclose(infile);
+    plane  = config->PIXBUF;
+    stride = width;
     valid = true;
 }
 
-Tagimage::~Tagimage()
+/* camera frame already in memory: an 8 bit grey image or the Y plane 
+ * of NV12/YUV420, used in place (the caller keeps it alive until the 
+ * Threshold stage is done), no JPEG encode and decode round trip 
+ * config->IMAGE_ORIENTATION is left as the caller set it (sensor rotation) */
+Tagimage::Tagimage(Config *_config, unsigned char *luma, int _width, int _height, int _stride)
 {
-	config->freePixbuf();
+	COLORS = 1;
+	config = _config;
+	plane  = luma;
+	width  = _width;
+	height = _height;
+	stride = _stride;
+	wrapped = true;
+	//as Probe does for files, a side must be longer than the threshold window
+	valid = plane != NULL && width > config->THRESHOLD_WINDOW_SIZE && height > config->THRESHOLD_WINDOW_SIZE 
+		&& stride >= width;
 }
 
-static int imageindex = 0;
+#if JPEG_LIB_VERSION >= 70
+#define LUMA_DCT_WIDTH(cinfo)  ((cinfo)->comp_info[0].DCT_h_scaled_size)
+#define LUMA_DCT_HEIGHT(cinfo) ((cinfo)->min_DCT_v_scaled_size)
+#else
+#define LUMA_DCT_WIDTH(cinfo)  ((cinfo)->comp_info[0].DCT_scaled_size)
+#define LUMA_DCT_HEIGHT(cinfo) ((cinfo)->min_DCT_scaled_size)
+#endif
 
+/* raw Y output lands in PIXBUF as is when Y is the full resolution
+ * component and its IDCT blocks end exactly at the row end (width a
+ * multiple of 8), anything else goes through the scanline path */
+bool
+Tagimage::canReadRawLuma(j_decompress_ptr cinfo)
+{
+	if( cinfo->jpeg_color_space != JCS_YCbCr && cinfo->jpeg_color_space != JCS_GRAYSCALE ) return false;
+	jpeg_component_info *luma = &cinfo->comp_info[0];
+	if( luma->h_samp_factor != cinfo->max_h_samp_factor ) return false;
+	if( luma->v_samp_factor != cinfo->max_v_samp_factor ) return false;
+	return (int)luma->width_in_blocks * LUMA_DCT_WIDTH(cinfo) == (int)cinfo->output_width;
+}
+
+/* one iMCU row per call, the Y rows point straight into PIXBUF, rows past
+ * the image end (last iMCU row) and the skipped chroma go to a scratch row */
 void
-Tagimage::processScanLine(unsigned char buffer[], int width)
+Tagimage::readRawLuma(j_decompress_ptr cinfo)
 {
-		for(int i=0; i<width; i++){
-       	     config->PIXBUF[imageindex] = (unsigned char) buffer[i];
-       	     imageindex++;
+	int rows = cinfo->max_v_samp_factor * LUMA_DCT_HEIGHT(cinfo);
+	JSAMPARRAY luma = (JSAMPARRAY) (*cinfo->mem->alloc_small)
+		((j_common_ptr) cinfo, JPOOL_IMAGE, rows * sizeof(JSAMPROW));
+	JSAMPARRAY scratch = (*cinfo->mem->alloc_sarray)
+		((j_common_ptr) cinfo, JPOOL_IMAGE, width, 1);
+	JSAMPARRAY skipped = (JSAMPARRAY) (*cinfo->mem->alloc_small)
+		((j_common_ptr) cinfo, JPOOL_IMAGE, rows * sizeof(JSAMPROW));
+	JSAMPIMAGE planes = (JSAMPIMAGE) (*cinfo->mem->alloc_small)
+		((j_common_ptr) cinfo, JPOOL_IMAGE, cinfo->num_components * sizeof(JSAMPARRAY));
+
+	for(int i = 0; i < rows; i++) skipped[i] = scratch[0];
+	planes[0] = luma;
+	for(int ci = 1; ci < cinfo->num_components; ci++) planes[ci] = skipped;
+
+	int line = 0;
+	while (cinfo->output_scanline < cinfo->output_height) {
+		for(int i = 0; i < rows; i++){
+			luma[i] = line + i < height ? config->PIXBUF + ((line + i) * width) : scratch[0];
 		}
-	/*
-		for(int i=0; i<3*width; i+=3){
-       	     //fprintf(stdout, " |%3d|%3d|%3d| ", buffer[i], buffer[i+1], buffer[i+2] );
-       	     r_buffer[imageindex] = (unsigned char) buffer[i];
-       	     g_buffer[imageindex] = (int) buffer[i+1];
-       	     b_buffer[imageindex] = (int) buffer[i+2];
-       	     imageindex++;
-    	}
-	*/
+		(void) jpeg_read_raw_data(cinfo, planes, rows);
+		line += rows;
+	}
+}
+
+/* grayscale scanlines decoded straight into PIXBUF rows, rec_outbuf_height
+ * rows per call (more than one with merged or scaled upsampling) */
+void
+Tagimage::readScanlines(j_decompress_ptr cinfo)
+{
+	int rows = cinfo->rec_outbuf_height;
+	JSAMPARRAY dest = (JSAMPARRAY) (*cinfo->mem->alloc_small)
+		((j_common_ptr) cinfo, JPOOL_IMAGE, rows * sizeof(JSAMPROW));
+
+	while (cinfo->output_scanline < cinfo->output_height) {
+		int line = cinfo->output_scanline;
+		int n = height - line < rows ? height - line : rows;
+		for(int i = 0; i < n; i++) dest[i] = config->PIXBUF + ((line + i) * width);
+		(void) jpeg_read_scanlines(cinfo, dest, n);
+	}
+}
+
+/* PNG or PNM (Pngreader, Pnmreader) into PIXBUF, false if neither */
+bool
+Tagimage::readNative(unsigned char *data, int size)
+{
+	bool ok = false;
+	if( ! Pngreader::isPng(data, size) && ! Pnmreader::isPnm(data, size) ) return false;
+	Probe probe;
+	if( probe.probe(config, data, size) != PROBE_OK ){
+		fprintf(stderr, "Image Error : %s image %dx%d\n", Probe::statusName(probe.STATUS), probe.WIDTH, probe.HEIGHT);
+		return true;
+	}
+	if( Pngreader::isPng(data, size) )      ok = Pngreader::read(config, data, size, &width, &height);
+	else if( Pnmreader::isPnm(data, size) ) ok = Pnmreader::read(config, data, size, &width, &height);
+	else return false;
+	if( ok ){
+		plane  = config->PIXBUF;
+		stride = width;
+		valid  = true;
+	}
+	return true;
+}
+
+unsigned char*
+Tagimage::readFile(FILE *file, int *size)
+{
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if( length <= 0 || length > 0x7fffffff ) return NULL;
+	unsigned char *data = new unsigned char[length];
+	if( fread(data, 1, length, file) != (size_t) length ){
+		delete [] data;
+		return NULL;
+	}
+	*size = (int) length;
+	return data;
+}
+
+Tagimage::~Tagimage()
+{
+	if(!wrapped) config->freePixbuf();
 }
 
 int
 Tagimage::getPixel( int x, int y ) 
 {
-	return config->PIXBUF[(y * width) + x];
+	return plane[(y * stride) + x];
+}
+
+unsigned char*
+Tagimage::getPlane()
+{
+	return plane;
+}
+
+int
+Tagimage::getStride()
+{
+	return stride;
 }
 
 int
@@ -145,7 +301,7 @@ Tagimage::getHeight()
 bool
 Tagimage::isValid()
 {
-	if(config->PIXBUF == NULL) valid = false;
+	if(plane == NULL) valid = false;
 	return valid;
 }
 
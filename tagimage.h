@@ -5,7 +5,11 @@
 #define _CRT_SECURE_NO_DEPRECATE 
 
 #include <string>
+#include <setjmp.h>
 #include "common.h"
+#include "pngreader.h"
+#include "pnmreader.h"
+#include "mappedfile.h"
 extern "C" { //extern for MingW only, GNU and MSVC++ are fine
 	#include <jpeglib.h> /* IJG JPEG LIBRARAY */
 	#include <jerror.h>  /* IJG JPEG LIBRARAY */
@@ -13,15 +17,27 @@ extern "C" { //extern for MingW only, GNU and MSVC++ are fine
 
 using namespace std;
 
+/* error manager that returns control to Tagimage instead of exit()
+ * so a bad image does not take down a long running process (server) */
+struct libjpeg_error_mgr {
+    struct jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+};
+
+void libjpeg_error_exit(j_common_ptr cinfo);
+
 class Tagimage
 {
 
 public:
 	Tagimage(Config *config);
+	Tagimage(Config *config, unsigned char *luma, int width, int height, int stride); //wraps, no copy
 	~Tagimage();
 	int  getPixel(int x, int y);
 	int  getWidth();
 	int  getHeight();
+	unsigned char* getPlane();	//8 bit grey, row y at getPlane() + y*getStride()
+	int  getStride();
 	bool isValid();
 	int  maxRGB();
 	int  COLORS;
@@ -30,9 +46,17 @@ private:
 	unsigned char* buffer;
 	Config *config;
 	int  width, height;
+	unsigned char *plane;	//PIXBUF, or the wrapped frame
+	int  stride;
+	bool wrapped;		//plane is not ours to free
 	bool valid;
 	static const int MAXRGB;
-	void processScanLine(unsigned char buffer[], int width);
+	void readJpeg(FILE *infile, unsigned char *data, int size);
+	void readScanlines(j_decompress_ptr cinfo);
+	bool readNative(unsigned char *data, int size);
+	static unsigned char* readFile(FILE *file, int *size);
+	void readRawLuma(j_decompress_ptr cinfo);
+	static bool canReadRawLuma(j_decompress_ptr cinfo);
 };
 
 #endif /* _TAGIMAGE_H_INCLUDED */
@@ -14,6 +14,14 @@ threadWorker(void *arg)
 	((Threshold *)task->threshold)->scheduleWork(task->id);
 	return NULL;
 }
+
+void* 
+retryWorker(void *arg) 
+{
+	struct thread_data *task = (struct thread_data*) arg;
+	((Threshold *)task->threshold)->scheduleRetry(task->id);
+	return NULL;
+}
 #endif
 
 Threshold::Threshold(Config *_config, Tagimage *_tagimage)
@@ -27,14 +35,26 @@ Threshold::Threshold(Config *_config, Tagimage *_tagimage)
 	span    = 0;
 	max_rgb = 0;
 	edgemap = NULL;
+	ta      = NULL;
+	plane   = NULL;
+	means   = NULL;
+	retry_offsets = NULL;
+	retry_maps    = NULL;
+	retry_count   = 0;
+	retry_threads = 1;
+	pixels  = NULL;
+	stride  = 0;
 	multi_threaded = false;
+#ifndef PRODUCTION
+	debug    = config->DEBUG;
+	pixdebug = config->CHECK_VISUAL_DEBUG();
+#endif
 
 	if(tagimage->isValid()) { 
 		resolveScaling();
 		max_rgb = tagimage->maxRGB();
 	}
 
-	pixdebug = config->CHECK_VISUAL_DEBUG();
 	if(pixdebug) dbgpixmap = config->DBGPIXMAP;
 	else         dbgpixmap = NULL;
 #ifndef PTHREAD
@@ -45,6 +65,14 @@ Threshold::Threshold(Config *_config, Tagimage *_tagimage)
 
 Threshold::~Threshold()
 {
+	if(plane != NULL) { 
+		delete [] plane;
+		config->trackFree(width*height);
+	}
+	if(means != NULL) { 
+		delete [] means;
+		config->trackFree(width*height*sizeof(short));
+	}
 }
 
 void
@@ -54,7 +82,12 @@ Threshold::resolveScaling()
 	int tag_height = tagimage->getHeight();
 	assert(tag_width > config.THRESHOLD_WINDOW_SIZE && tag_height > config.THRESHOLD_WINDOW_SIZE);
 
-	if(config->PIXMAP_NATIVE_SCALE || 
+	int longer = tag_width > tag_height ? tag_width : tag_height;
+	//close enough already (JPG_SCALE M/8 output) no second rescale
+	bool close = longer >= config->PIXMAP_SCALE_SIZE && 
+		longer * 100 <= config->PIXMAP_SCALE_SIZE * (100 + config->PIXMAP_SCALE_FLEX_PERCENT);
+
+	if(config->PIXMAP_NATIVE_SCALE || close ||
 		config->PIXMAP_SCALE_SIZE < config->THRESHOLD_WINDOW_SIZE) {
 			width  = tag_width;
 			height = tag_height;
@@ -76,7 +109,7 @@ Threshold::resolveScaling()
 		}
 	}
 
-	if(config->DEBUG) cout << "SCALE: native_scale=" << config->PIXMAP_NATIVE_SCALE 
+	if(debug) cout << "SCALE: native_scale=" << config->PIXMAP_NATIVE_SCALE 
 		<< " jpeg_scale=" << config->JPG_SCALE
 		<< " fast_scale=" << config->PIXMAP_FAST_SCALE
 		<< " scale=" << scale << " span=" << span 
@@ -84,37 +117,44 @@ Threshold::resolveScaling()
 		<< " width=" << width << " height=" << height 
 		<< " window=" << config->THRESHOLD_WINDOW_SIZE << endl;
 
-	config->EDGE_MAP = new bool[width*height]; 
-	edgemap = config->EDGE_MAP;
+	edgemap = config->newEdgemap(width*height); 
 	config->GRID_WIDTH = width;
 	config->GRID_HEIGHT = height;
+
+	if(scale == 1){
+		pixels = tagimage->getPlane();
+		stride = tagimage->getStride();
+	}else{
+		resample(tag_width, tag_height);
+	}
 }
 
-//NOTE: Removed tagimage::getPixel() bounds check for fast common case (scale==1)
-// So make sure all  bounds check are done before calling tagimage::getPixel()
+/*
+* Resample the Tagimage plane once into the width*height plane the thresholding reads,
+* instead of scaling in getPixel() at every window update 
+* FAST: skip sampling   SLOW: area average (see Downscaler)
+*/
+void
+Threshold::resample(int tag_width, int tag_height)
+{
+	plane = new unsigned char[width*height];
+	config->trackAlloc(width*height);
+	pixels = plane;
+	stride = width;
+	unsigned char *src = tagimage->getPlane();
+	int src_stride = tagimage->getStride();
+	if(config->PIXMAP_FAST_SCALE) 
+		Downscaler::nearest(src, tag_width, tag_height, src_stride, plane, width, height, scale);
+	else 
+		Downscaler::average(src, tag_width, tag_height, src_stride, plane, width, height, scale);
+}
+
+//NOTE: no bounds check, make sure all bounds check are done before calling
 int
 Threshold::getPixel(int x, int y)
 {
-	//NOTE: tagimage->getPixel(x,y) is same as config->PIXBUF[(y * width) + x];
-
-	//no scaling, fastest
-	if(scale == 1) return config->PIXBUF[(y * width) + x];
-	//scaling by skipping, faster 
-	if(config->PIXMAP_FAST_SCALE)   
-		return tagimage->getPixel((int)((float)x*scale), (int)((float)y*scale) );	
-	if( x == 0 || y == 0 ) //begin edge bounds check
-		return tagimage->getPixel((int)((float)x*scale), (int)((float)y*scale) );	
-	//scaling by averaging, slower
-	int pixel = 0, count = 0;
-	int ix = (int)((float)x*scale);
-	int iy = (int)((float)y*scale);
-	for(int i=0; i<=span*2; i++) { 
-		pixel+=tagimage->getPixel(ix-span+i, iy);
-		pixel+=tagimage->getPixel(ix, iy-span+i);
-		count++;
-	}
-	assert( count == (span*2)+1 );
-	return (pixel/count);
+	//the Tagimage plane when not scaled, else the plane resample() made
+	return pixels[(y * stride) + x];
 }
 
 
@@ -129,13 +169,32 @@ Threshold::scheduleWork(int id)
 }
 
 void
-Threshold::computeEdgemap()
+Threshold::beginEdgemap()
 {
 	ta = new bool[width*height]; //thresholded pixel on/off array //TODO  moving window of (3*width)
+	config->trackAlloc(width*height*sizeof(bool));
 	for(int x = 0; x < (width*height); x++) edgemap[x] = false; 
+}
+
+void
+Threshold::endEdgemap()
+{
+	delete [] ta;
+	ta = NULL;
+	config->trackFree(width*height*sizeof(bool));
+}
+
+void
+Threshold::computeEdgemap()
+{
+	long long start = Timer::now();
+	beginEdgemap();
 #ifdef PTHREAD
 	if( config->THREADS == 2 ){
 		multi_threaded = true;
+		//the workers can not touch STATS, charge both td and ts here
+		long long work_bytes = 2 * ((long long)width*height + width) * sizeof(int);
+		config->trackAlloc(work_bytes);
 		pthread_t threads[2];
 		struct thread_data t_data[2];
 		pthread_attr_t attr;
@@ -150,16 +209,19 @@ Threshold::computeEdgemap()
 		for(int i = 0; i<2; i++){
 			if (pthread_join(threads[i], NULL) != 0) return;
 		}
-		fillEdgemap(); //for multi thread, do it after thresholding loop
+		config->trackFree(work_bytes);
+		long long mark = Timer::now();
+		fillEdgemap(ta, edgemap); //for multi thread, do it after thresholding loop
+		config->STATS->edgemark = Timer::now() - mark;
 	} else {
 #endif
 		int offset = config->THRESHOLD_OFFSET * tagimage->COLORS * config->THRESHOLD_RGB_FACTOR;
-		if(scale == 1) computeEdgemapOpt(config->THRESHOLD_WINDOW_SIZE, offset);
-		else           computeEdgemap(config->THRESHOLD_WINDOW_SIZE, offset, 0, height);
+		computeEdgemapOpt(config->THRESHOLD_WINDOW_SIZE, offset);
 #ifdef PTHREAD
 	}
 #endif
-	delete [] ta;
+	endEdgemap();
+	config->STATS->threshold = Timer::now() - start - config->STATS->edgemark;
 }
 
 /* 
@@ -188,11 +250,10 @@ Threshold::computeEdgemap()
 
 /*
  computeEdgemap	   
-	- Extra step of getPixel() function call to access  Config->PIXBUF[]
-	- getPixel() handles the span and scale
+	- Extra step of getPixel() function call to access the pixels
+	- used by the threads, on an image segment
  computeEdgemapOpt 
-	- Directly Access Config->PIXBUF[]
-	- only if not using span or scale
+	- Directly Access the pixels (Tagimage plane or the resampled plane)
 	- Saves only 0.01 second in performance
 
 Identical versions, one for slightly better performance 
@@ -207,10 +268,11 @@ Threshold::computeEdgemapOpt(int size, int offset)
 	int ex = 0, ey = 0, ei = 0;
 	int blocksize = size*size, radius = size/2, half_block = blocksize/2;
 
-	unsigned char* pixbuf = config->PIXBUF;
+	unsigned char* pixbuf = pixels;
 
 	int *td = new int[width*height]; //threshold deltas //TODO moving window of (size*width)
 	int *ts = new int[width];   //threshold sums
+	config->trackAlloc(((long long)width*height + width) * sizeof(int));
 
 	for(int x = 0;  x < (width*height); x++) td[x] = 0;
     for(int x = 0; x < width; x++)  ts[x] = 0;
@@ -222,33 +284,33 @@ Threshold::computeEdgemapOpt(int size, int offset)
 				threshold = ts[x] / (size*(radius+height-y)); 
 			}else if( y > radius && x == 0 ){ //normal: very first 
 				di = ((y+radius)*width) + x;
-				for(int i = 0; i < radius; i++) td[di]+=pixbuf[i + width * (y+radius)]; 
+				for(int i = 0; i < radius; i++) td[di]+=pixbuf[i + stride * (y+radius)]; 
 				ts[x] += td[di] - td[((y-radius-1)*width)+x];
 				threshold = ts[x] /half_block; 
 				lastdelta = td[di];
 			}else if( y > radius && x >= width - radius ){//normal: partial end 
 				di = ((y+radius)*width) + x;
-				td[di] = lastdelta - pixbuf[(x-radius-1) + width * (y+radius)];
+				td[di] = lastdelta - pixbuf[(x-radius-1) + stride * (y+radius)];
 				ts[x] += td[di] - td[((y-radius)*width)+x];
 				threshold = ts[x] / ((width-x+radius)*size);
 				lastdelta = td[di];
 			}else if( y > radius && x <=radius ){ //normal: partial begin 
 				di = ((y+radius)*width) + x;
-				td[di]=lastdelta + pixbuf[(x+radius) + width * (y+radius)];
+				td[di]=lastdelta + pixbuf[(x+radius) + stride * (y+radius)];
 				ts[x]+= td[di] - td[((y-radius)*width)+x];
 				threshold = ts[x] / ((x+radius)*size);
 				lastdelta = td[di];
 			}else if( y > radius ){ //normal: all full (90% of all)
 				di = ((y+radius)*width) + x;
-				td[di] = lastdelta + pixbuf[(x+radius) + width * (y+radius)] 
-					- pixbuf[(x-radius-1) + width * (y+radius)];
+				td[di] = lastdelta + pixbuf[(x+radius) + stride * (y+radius)] 
+					- pixbuf[(x-radius-1) + stride * (y+radius)];
 				ts[x] += td[di] - td[((y-radius)*width)+x];
 				threshold = ts[x] / blocksize;
 				lastdelta = td[di];
 			}else if( x == 0 && y == 0 ){ //first top left block 
 				for(int j = 0; j < radius; j++){
 					di = j*width;
-					for(int i = 0; i < radius; i++) td[di] += pixbuf[i + width *  j];
+					for(int i = 0; i < radius; i++) td[di] += pixbuf[i + stride * j];
 					ts[x] += td[di];
 				}
 				threshold = ts[x]  /(blocksize/4); 
@@ -256,8 +318,8 @@ Threshold::computeEdgemapOpt(int size, int offset)
 				for(int j = 0; j < radius; j++){
 					di = (j*width) + x;
 					td[di] = td[di-1];
-					if(x > radius)    td[di] -= pixbuf[(x-radius-1) + width *  j];
-					if(x <= width-radius) td[di] += pixbuf[(x+radius) + width *  j];
+					if(x > radius)    td[di] -= pixbuf[(x-radius-1) + stride * j];
+					if(x <= width-radius) td[di] += pixbuf[(x+radius) + stride * j];
 					ts[x] += td[di];
 				}
 				if(x <= radius) threshold = ts[x] / (radius*(x+radius));
@@ -266,24 +328,25 @@ Threshold::computeEdgemapOpt(int size, int offset)
 			}else if( y <= radius && x <= radius){ //partial: top row begin
 				di = ((y+radius)*width) + x;
 				for(int i = 0; i < x+radius; i++) td[di] 
-				+= pixbuf[i + width * (y+radius)]; 
+				+= pixbuf[i + stride * (y+radius)]; 
 				ts[x] += td[di];
 				threshold = ts[x] / ((x+radius)*(y+radius)); 
 			}else if( y <= radius && x >= width -radius){ //partial: top row end
 				di = ((y+radius)*width) + x;
 				for(int i = width; i > x-radius; i--) td[di] 
-				+= pixbuf[i + width * (y+radius)];
+				+= pixbuf[i + stride * (y+radius)];
 				ts[x] += td[di];
 				threshold = ts[x] / ((width-x+radius)*(y+radius)); 
 			}else if( y <= radius ){ //partial: top row all
 				di = ((y+radius)*width) + x;
 				for(int i = 0; i < size; i++) td[di] 
-				+= pixbuf[(x-radius+i) + width * (y+radius)]; 
+				+= pixbuf[(x-radius+i) + stride * (y+radius)]; 
 				ts[x] += td[di];
 				threshold = ts[x] / (size*(y+radius)); 
 			}
+			if(means != NULL) means[(y*width)+x] = (short)threshold;
 			threshold-=offset;
-			thispixel = pixbuf[x + width *  y] < threshold ? true : false;
+			thispixel = pixbuf[x + stride * y] < threshold ? true : false;
 			ta[(y*width)+x] = thispixel;
 			if(pixdebug) thispixel ? d_setPixelFilled(x, y) : d_setPixelBlank(x, y);
 			if( ! multi_threaded  ){ //single thread do it in the thresholding loop
@@ -317,6 +380,7 @@ Threshold::computeEdgemapOpt(int size, int offset)
 
 	delete [] ts;
 	delete [] td;
+	config->trackFree(((long long)width*height + width) * sizeof(int));
 }
 
 // parallel access from threads 
@@ -337,12 +401,13 @@ Threshold::computeEdgemap(int size, int offset, int y1, int y2)
 
 	int *td = new int[width*height]; //threshold deltas //TODO moving window of (size*width)
 	int *ts = new int[width];   //threshold sums
+	if(!multi_threaded) config->trackAlloc(((long long)width*height + width) * sizeof(int));
 
 	for(int x = 0;  x < (width*height); x++) td[x] = 0;
     for(int x = 0; x < width; x++)  ts[x] = 0;
 
 	for(int y = y1; y < y2; y++){ 
-		if(config->DEBUG) { //TODO: Remove once threads are final 
+		if(debug) { //TODO: Remove once threads are final 
 			if(y1 == 0) printf("*");
 			if(y1 > 0) printf("-");
 		}
@@ -416,6 +481,7 @@ Threshold::computeEdgemap(int size, int offset, int y1, int y2)
 			//skip overlap only for beginning on the middle 
 			//will be covered by the one above ( applies to multi thread only)
 			if(  y1 == 0 || y > y1+size){ 
+				if(means != NULL) means[(y*width)+x] = (short)threshold;
 				threshold-=offset;
 				thispixel = getPixel(x, y) < threshold ? true : false;
 				ta[(y*width)+x] = thispixel;
@@ -453,32 +519,33 @@ Threshold::computeEdgemap(int size, int offset, int y1, int y2)
 
 	delete [] ts;
 	delete [] td;
+	if(!multi_threaded) config->trackFree(((long long)width*height + width) * sizeof(int));
 }
 
 void 
-Threshold::fillEdgemap()
+Threshold::fillEdgemap(bool *on, bool *map)
 {
 	int ex = 0, ey = 0, ei = 0; 
 	bool epixel = false;
 
 	for(int y = 0; y < height; y++){ 
 		for(int x = 0; x < width; x++){
-			if( y > 2){ //edge marking based on ta[]
+			if( y > 2){ //edge marking based on the on/off array
 				ex = x; ey = y-2;
 				ei = ((ey)*width)+ex;
-				epixel = ta[ei];
+				epixel = on[ei];
 				if( epixel ){
 					if( ex > 0 && ex < width ){
-						if( epixel ^ ta[(ey*width)+ex-1]
-						|| epixel ^ ta[(ey*width)+ex+1]
-						|| epixel ^ ta[((ey-1)*width)+ex]
-						|| epixel ^ ta[((ey-1)*width)+ex+1]
-						|| epixel ^ ta[((ey-1)*width)+ex-1]
-						|| epixel ^ ta[((ey+1)*width)+ex]
-						|| epixel ^ ta[((ey+1)*width)+ex+1]
-						|| epixel ^ ta[((ey+1)*width)+ex-1] ){
-							edgemap[ei] = true;		
-							if(pixdebug) d_setPixelMarked(ex, ey);	
+						if( epixel ^ on[(ey*width)+ex-1]
+						|| epixel ^ on[(ey*width)+ex+1]
+						|| epixel ^ on[((ey-1)*width)+ex]
+						|| epixel ^ on[((ey-1)*width)+ex+1]
+						|| epixel ^ on[((ey-1)*width)+ex-1]
+						|| epixel ^ on[((ey+1)*width)+ex]
+						|| epixel ^ on[((ey+1)*width)+ex+1]
+						|| epixel ^ on[((ey+1)*width)+ex-1] ){
+							map[ei] = true;		
+							if(pixdebug && map == edgemap) d_setPixelMarked(ex, ey);	
 						}
 					}
 				}
@@ -487,6 +554,83 @@ Threshold::fillEdgemap()
 	}
 }
 
+void
+Threshold::keepMeans()
+{
+	if(means != NULL || width*height == 0) return;
+	means = new short[width*height];
+	config->trackAlloc(width*height*sizeof(short));
+}
+
+/* 
+* The window sums do not depend on the offset, only the final compare does:
+* with the means kept from the first computeEdgemap() an edge map for another 
+* offset is a compare and an edge marking pass, one thread per map up to THREADS 
+* maps are width*height, allocated by the caller, offsets as THRESHOLD_OFFSET
+*/
+void
+Threshold::retryEdgemaps(int *offsets, int n, bool **maps)
+{
+	if(means == NULL) return;
+	retry_offsets = offsets;
+	retry_maps    = maps;
+	retry_count   = n;
+#ifdef PTHREAD
+	int nthreads = config->THREADS < n ? config->THREADS : n;
+	if( nthreads > Config::MAX_THRESHOLD_RETRIES ) nthreads = Config::MAX_THRESHOLD_RETRIES;
+	if( nthreads > 1 ){
+		retry_threads = nthreads;
+		//the workers can not touch STATS, charge their on/off arrays here
+		long long work_bytes = nthreads * (long long)width*height * sizeof(bool);
+		config->trackAlloc(work_bytes);
+		pthread_t threads[Config::MAX_THRESHOLD_RETRIES];
+		struct thread_data t_data[Config::MAX_THRESHOLD_RETRIES];
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+   		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		int started = 0;
+		for(int i = 0; i<nthreads; i++){
+			t_data[i].id = i;
+			t_data[i].threshold = this;
+			if (pthread_create(&threads[i], &attr, retryWorker, (void *)&t_data[i]) != 0) break;
+			started++;
+		}
+		pthread_attr_destroy(&attr);
+		for(int i = 0; i<started; i++) pthread_join(threads[i], NULL);
+		config->trackFree(work_bytes);
+		for(int i = started; i<nthreads; i++) scheduleRetry(i); //no thread, do its share here
+		return;
+	}
+#endif
+	config->trackAlloc(width*height*sizeof(bool));
+	for(int i = 0; i < n; i++) markEdgemap(offsets[i], maps[i]);
+	config->trackFree(width*height*sizeof(bool));
+}
+
+// parallel access from threads 
+// do not modify class variable values here without mutex 
+void
+Threshold::scheduleRetry(int id)
+{
+	for(int i = id; i < retry_count; i += retry_threads) markEdgemap(retry_offsets[i], retry_maps[i]);
+}
+
+void
+Threshold::markEdgemap(int offset, bool *map)
+{
+	offset *= tagimage->COLORS * config->THRESHOLD_RGB_FACTOR;
+	bool *on = new bool[width*height];
+	for(int y = 0; y < height; y++){ 
+		unsigned char *row = pixels + (stride * y);
+		short *mean = means + (width * y);
+		bool *r = on + (width * y);
+		for(int x = 0; x < width; x++) r[x] = row[x] < mean[x] - offset;
+	}
+	for(int x = 0; x < (width*height); x++) map[x] = false; 
+	fillEdgemap(on, map);
+	delete [] on;
+}
+
 void
 Threshold::d_setPixelMarked(int x, int y) //GREEN
 {
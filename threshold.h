@@ -5,6 +5,8 @@
 
 #include "tagimage.h"
 #include "pixmap.h"
+#include "timer.h"
+#include "downscaler.h"
 #include "common.h"
 
 #ifdef PTHREAD
@@ -25,14 +27,27 @@ public:
 	void computeEdgemapOpt(int size, int offset);
 	void computeEdgemap(int size, int offset, int y1, int y2);
 	void computeEdgemap();
+	void beginEdgemap();	//work buffers for calling the computeEdgemap* variants directly
+	void endEdgemap();
 	bool *getEdgeMap();
 	void scheduleWork(int id);
+	void keepMeans();		//keep the window means of the next computeEdgemap() for retryEdgemaps()
+	void retryEdgemaps(int *offsets, int n, bool **maps); //n more edge maps, no window sums
+	void scheduleRetry(int id);
 
 private:
 	Config   *config;
 	Tagimage *tagimage;
 	bool  *edgemap;
 	bool  *ta;
+	unsigned char *plane;	//resampled image when scaled, else NULL
+	short *means;		//window mean of each pixel (before the offset) when kept, else NULL
+	int   *retry_offsets;	//retryEdgemaps() work for the threads
+	bool **retry_maps;
+	int   retry_count;
+	int   retry_threads;	//the workers take every retry_threads-th map
+	unsigned char *pixels;	//what the thresholding reads, the Tagimage plane or plane
+	int   stride;		//row stride of pixels
 	int   width, height;
 	float scale;
 	int   span;
@@ -41,10 +56,18 @@ private:
 
 	int  getPixel(int i, int j);
 	void resolveScaling();
-	void fillEdgemap();
+	void resample(int tag_width, int tag_height);
+	void fillEdgemap(bool *on, bool *map);
+	void markEdgemap(int offset, bool *map);
 
 	//debug only 
+#ifdef PRODUCTION
+	static const bool debug = false;
+	static const bool pixdebug = false;
+#else
+	bool debug;
 	bool pixdebug;
+#endif
 	Pixmap *dbgpixmap;
 
 	void d_setPixelMarked(int i, int j);
@@ -0,0 +1,908 @@
+/*
+* End to end throughput benchmark with an accuracy gate
+*
+*	throughput corpusdir|gen [max threads] [image count] [j]
+*	throughput corpusdir|gen [max threads] [image count] tune [target percent] [profile]
+*	throughput gen 1 [frame count] stream
+*	throughput gen 1 [image count] tiles
+*
+* corpusdir: the JPEG, PNG and PNM files in it, ground truth read from corpusdir/truth.txt
+*            ("file code" per line, as printed by gentag) when present
+* gen:       image count synthetic tags rendered in memory with Generator
+*
+* Every variant (thread counts, scaling modes, window sizes) decodes the
+* whole corpus, held in memory so file i/o is not timed, and reports
+* images/sec, decode latency percentiles (per image, from Stats::total),
+* peak RSS and tags read correctly. Speedup and read rate are relative to
+* the baseline (default options, one thread). A variant reading fewer tags
+* or misreading more than the baseline FAILs the gate, exit code is then 2.
+* Without ground truth the gate compares the complete tags decoded only.
+* Images are submitted in decreasing Probe::COST order (header only probe,
+* which also counts the images Tagimage will reject).
+* j: JSON output instead of the table
+*
+* tune: sweeps the threshold and scale options instead (see tune()), prints 
+* the Pareto frontier of tags read vs time per image and writes the fastest 
+* setting reaching target percent as a Config profile (stdout when no file)
+*
+* stream: a generated frame sequence through Decoder::processFrame() instead, 
+* checking codes, anchor boxes, isNewTag() and tracking (see runStream())
+*
+* tiles: generated images of several tags through Decoder::processTags(), 
+* checking every tag is found with its anchor box (see runTiles())
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <set>
+#include <fstream>
+#include <dirent.h>
+#include <sys/resource.h>
+#include "decoder.h"
+#include "generator.h"
+#include "probe.h"
+#ifdef PTHREAD
+#include "asyncdecoder.h"
+#endif
+
+struct Benchimage {
+	string name;
+	unsigned char *data;
+	int  size;
+	Mappedfile *mapping;	//corpus files are mapped, else data is malloc()ed
+	bool has_truth;
+	int  truth[12];
+	int  tag[12];		//last decode
+	long long latency;	//last decode, usecs
+	long long cost;		//Probe::COST, submission order
+};
+
+struct Variant {
+	string name;
+	int  threads;
+	int  window;
+	bool fast_scale;
+	bool jpg_scale;
+	int  offset;		//THRESHOLD_OFFSET
+	int  scale_size;	//PIXMAP_SCALE_SIZE
+	int  scale_flex;	//PIXMAP_SCALE_FLEX_PERCENT
+	int  anchor_flex;	//ANCHOR_BOX_FLEX_PERCENT
+	int  shape_flex;	//SHAPE_BOX_FLEX_PERCENT
+	int  floor;		//PATTERN_CONFIDENCE_FLOOR
+};
+
+struct Variantresult {
+	Variant variant;
+	double seconds;
+	double images_per_sec;
+	double mean, p50, p95, p99;	//msecs
+	long   peak_rss;	//KB
+	int    decoded;		//complete tags
+	int    correct;		//complete and equal to the ground truth
+	int    wrong;		//complete but not the ground truth
+	bool   pass;
+};
+
+static bool
+readFile(string filename, Benchimage *image)
+{
+	image->mapping = Mappedfile::open(filename); //shared by all the decoder threads, no copy
+	if( image->mapping != NULL ){
+		image->data = image->mapping->getData();
+		image->size = image->mapping->getSize();
+		return true;
+	}
+	FILE *file = fopen(filename.c_str(), "rb");
+	if( file == NULL ) return false;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if( size <= 0 ){
+		fclose(file);
+		return false;
+	}
+	image->data = (unsigned char *) malloc(size);
+	image->size = (int) fread(image->data, 1, size, file);
+	fclose(file);
+	return image->size == size;
+}
+
+static bool
+parseCode(const char *s, int *code)
+{
+	if( strlen(s) != 12 ) return false;
+	for(int i = 0; i < 12; i++){
+		if( s[i] < '0' || s[i] > '9' ) return false;
+		code[i] = s[i] - '0';
+	}
+	return true;
+}
+
+static string
+baseName(string name)
+{
+	size_t slash = name.find_last_of("/\\");
+	return slash == string::npos ? name : name.substr(slash + 1);
+}
+
+//the formats Tagimage reads: JPEG, PNG and PNM (any case)
+static bool
+isImageName(string name)
+{
+	static const char *suffixes[] = { ".jpg", ".jpeg", ".png", ".pgm", ".ppm", ".pnm" };
+	size_t dot = name.find_last_of('.');
+	if( dot == string::npos || dot == 0 ) return false;
+	string suffix = name.substr(dot);
+	for(size_t i = 0; i < suffix.size(); i++) suffix[i] = (char) tolower(suffix[i]);
+	for(int i = 0; i < 6; i++) if( suffix == suffixes[i] ) return true;
+	return false;
+}
+
+static bool
+loadDirectory(string dirname, vector<Benchimage> &images)
+{
+	DIR *dir = opendir(dirname.c_str());
+	if( dir == NULL ){
+		cerr << "can't open " << dirname << endl;
+		return false;
+	}
+	vector<string> names;
+	struct dirent *entry;
+	while( (entry = readdir(dir)) != NULL ){
+		string name = entry->d_name;
+		if( isImageName(name) ) names.push_back(name);
+	}
+	closedir(dir);
+	sort(names.begin(), names.end());
+
+	map<string, string> truth;
+	FILE *file = fopen((dirname + "/truth.txt").c_str(), "r");
+	if( file != NULL ){
+		char name[1024], code[64];
+		while( fscanf(file, "%1023s %63s", name, code) == 2 ) truth[baseName(name)] = code;
+		fclose(file);
+	}
+
+	for(size_t i = 0; i < names.size(); i++){
+		Benchimage image;
+		image.name = names[i];
+		image.has_truth = truth.count(names[i]) > 0
+			&& parseCode(truth[names[i]].c_str(), image.truth);
+		if( readFile(dirname + "/" + names[i], &image) ) images.push_back(image);
+		else cerr << "can't read " << names[i] << endl;
+	}
+	return images.size() > 0;
+}
+
+//a spread of sizes and distortions the decoder is expected to read
+static bool
+loadGenerated(int count, vector<Benchimage> &images)
+{
+	static const int sizes[4][2] = { {640, 480}, {1280, 960}, {2048, 1536}, {4000, 3000} };
+	for(int i = 0; i < count; i++){
+		Generator *generator = new Generator();
+		generator->SEED     = i + 1;
+		generator->WIDTH    = sizes[i % 4][0];
+		generator->HEIGHT   = sizes[i % 4][1];
+		generator->ROTATION = (i / 4) % 4;
+		generator->TILT     = ((i * 7) % 11) - 5;
+		generator->BLUR     = (i % 3) * generator->WIDTH / 640;
+		generator->NOISE    = (i % 4) * 4;
+		generator->CLUTTER  = (i % 5) * 2;
+		generator->QUALITY  = 70 + (i % 6) * 5;
+
+		Benchimage image;
+		image.mapping = NULL;
+		ostringstream name;
+		name << "gen-" << i;
+		image.name = name.str();
+		image.has_truth = true;
+		generator->randomCode(image.truth);
+		unsigned long size = 0;
+		bool ok = generator->render(image.truth) && generator->encodeImage(&image.data, &size);
+		delete generator;
+		if( ! ok ) return false;
+		image.size = (int) size;
+		images.push_back(image);
+	}
+	return images.size() > 0;
+}
+
+static void
+releaseImages(vector<Benchimage> &images)
+{
+	for(size_t i = 0; i < images.size(); i++){
+		if( images[i].mapping != NULL ) images[i].mapping->release();
+		else free(images[i].data);
+	}
+}
+
+//peak resident set since the last reset, KB
+static void
+resetPeakRSS()
+{
+	FILE *file = fopen("/proc/self/clear_refs", "w");
+	if( file == NULL ) return;
+	fputs("5", file);
+	fclose(file);
+}
+
+static long
+peakRSS()
+{
+	long kb = 0;
+	FILE *file = fopen("/proc/self/status", "r");
+	if( file != NULL ){
+		char line[256];
+		while( fgets(line, sizeof(line), file) != NULL ){
+			if( strncmp(line, "VmHWM:", 6) == 0 ) kb = atol(line + 6);
+		}
+		fclose(file);
+	}
+	if( kb > 0 ) return kb;
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss; //never reset, KB on linux
+}
+
+static void
+setOptions(Config *config, Variant &variant)
+{
+	config->THREADS = 1;
+	config->THRESHOLD_WINDOW_SIZE = variant.window;
+	config->PIXMAP_FAST_SCALE = variant.fast_scale;
+	config->JPG_SCALE = variant.jpg_scale;
+	config->THRESHOLD_OFFSET = variant.offset;
+	config->PIXMAP_SCALE_SIZE = variant.scale_size;
+	config->PIXMAP_SCALE_FLEX_PERCENT = variant.scale_flex;
+	config->ANCHOR_BOX_FLEX_PERCENT = variant.anchor_flex;
+	config->SHAPE_BOX_FLEX_PERCENT = variant.shape_flex;
+	config->PATTERN_CONFIDENCE_FLOOR = variant.floor;
+	config->ARGS_OK = true;
+}
+
+#ifdef PTHREAD
+static void
+decodeDone(Decoderesult *result)
+{
+	Benchimage *image = (Benchimage *) result->arg;
+	for(int i = 0; i < 12; i++) image->tag[i] = result->tag[i];
+	image->latency = result->stats.total;
+}
+
+static void
+decodeAll(Variant &variant, vector<Benchimage> &images)
+{
+	Config *options = new Config();
+	setOptions(options, variant);
+	Asyncdecoder *decoder = new Asyncdecoder(options, variant.threads, variant.threads * 2);
+	for(size_t i = 0; i < images.size(); i++){
+		decoder->submit(images[i].data, images[i].size, decodeDone, (void *) &images[i], 0);
+	}
+	delete decoder; //waits for all
+	delete options;
+}
+#else
+static void
+decodeAll(Variant &variant, vector<Benchimage> &images)
+{
+	Stats stats;
+	Decoder *decoder = new Decoder((unsigned char *) NULL, 0);
+	for(size_t i = 0; i < images.size(); i++){
+		decoder->setImage(images[i].data, images[i].size);
+		setOptions(decoder->getConfig(), variant);
+		for(int j = 0; j < 12; j++) images[i].tag[j] = -1;
+		if( decoder->processTag() ) decoder->copyTag(images[i].tag);
+		decoder->copyStats(&stats);
+		images[i].latency = stats.total;
+	}
+	delete decoder;
+}
+#endif
+
+static double
+percentile(vector<long long> &sorted, int p)
+{
+	if( sorted.size() == 0 ) return 0;
+	size_t i = (size_t)(((sorted.size() - 1) * p + 50) / 100);
+	return sorted[i] / 1000.0;
+}
+
+static Variantresult
+runVariant(Variant &variant, vector<Benchimage> &images)
+{
+	Variantresult r;
+	r.variant = variant;
+	for(size_t i = 0; i < images.size(); i++){
+		for(int j = 0; j < 12; j++) images[i].tag[j] = -1;
+		images[i].latency = 0;
+	}
+
+	resetPeakRSS();
+	long long start = Timer::now();
+	decodeAll(variant, images);
+	long long elapsed = Timer::now() - start;
+	r.peak_rss = peakRSS();
+
+	vector<long long> latencies;
+	long long sum = 0;
+	r.decoded = r.correct = r.wrong = 0;
+	for(size_t i = 0; i < images.size(); i++){
+		Benchimage &image = images[i];
+		latencies.push_back(image.latency);
+		sum += image.latency;
+		bool complete = true, match = image.has_truth;
+		for(int j = 0; j < 12; j++){
+			if( image.tag[j] < 0 ) complete = false;
+			if( image.has_truth && image.tag[j] != image.truth[j] ) match = false;
+		}
+		if( ! complete ) continue;
+		r.decoded++;
+		if( match ) r.correct++;
+		else if( image.has_truth ) r.wrong++;
+	}
+	sort(latencies.begin(), latencies.end());
+	r.seconds = elapsed / 1000000.0;
+	r.images_per_sec = elapsed > 0 ? images.size() / r.seconds : 0;
+	r.mean = images.size() > 0 ? sum / 1000.0 / images.size() : 0;
+	r.p50 = percentile(latencies, 50);
+	r.p95 = percentile(latencies, 95);
+	r.p99 = percentile(latencies, 99);
+	r.pass = true;
+	return r;
+}
+
+//the most expensive images first, so no long decode starts last
+static bool
+costlier(const Benchimage &a, const Benchimage &b)
+{
+	return a.cost > b.cost;
+}
+
+static Variant
+makeVariant(string name, int threads, int window, bool fast_scale, bool jpg_scale)
+{
+	Config defaults;
+	Variant v;
+	v.name = name;
+	v.threads = threads;
+	v.window = window;
+	v.fast_scale = fast_scale;
+	v.jpg_scale = jpg_scale;
+	v.offset = defaults.THRESHOLD_OFFSET;
+	v.scale_size = defaults.PIXMAP_SCALE_SIZE;
+	v.scale_flex = defaults.PIXMAP_SCALE_FLEX_PERCENT;
+	v.anchor_flex = defaults.ANCHOR_BOX_FLEX_PERCENT;
+	v.shape_flex = defaults.SHAPE_BOX_FLEX_PERCENT;
+	v.floor = defaults.PATTERN_CONFIDENCE_FLOOR;
+	return v;
+}
+
+//tags read: correct ones against ground truth, else complete ones
+static int
+tagsRead(Variantresult &r, int truths)
+{
+	return truths > 0 ? r.correct : r.decoded;
+}
+
+//another setting reads as many tags in less time, or more in no more time
+static bool
+dominated(Variantresult &r, vector<Variantresult> &results, int truths)
+{
+	for(size_t i = 0; i < results.size(); i++){
+		Variantresult &o = results[i];
+		if( tagsRead(o, truths) >= tagsRead(r, truths) && o.mean < r.mean ) return true;
+		if( tagsRead(o, truths) > tagsRead(r, truths) && o.mean <= r.mean ) return true;
+	}
+	return false;
+}
+
+//indices of the Pareto frontier, fastest first
+static vector<int>
+frontier(vector<Variantresult> &results, int truths)
+{
+	vector< pair<double, int> > points;
+	for(size_t i = 0; i < results.size(); i++){
+		if( ! dominated(results[i], results, truths) ) points.push_back(make_pair(results[i].mean, (int) i));
+	}
+	sort(points.begin(), points.end());
+	vector<int> indices;
+	for(size_t i = 0; i < points.size(); i++) indices.push_back(points[i].second);
+	return indices;
+}
+
+static string
+settingName(Variant &v)
+{
+	ostringstream name;
+	name << "w" << v.window << "-o" << v.offset << "-s" << v.scale_size 
+		<< "-f" << v.scale_flex << "-a" << v.anchor_flex << "-b" << v.shape_flex << "-c" << v.floor;
+	return name.str();
+}
+
+//decode the corpus with this setting unless it was tried already
+static void
+trySetting(Variant v, vector<Benchimage> &images, vector<Variantresult> &results, set<string> &tried)
+{
+	v.name = settingName(v);
+	if( ! tried.insert(v.name).second ) return;
+	results.push_back(runVariant(v, images));
+	cerr << "." << flush;
+}
+
+/* 
+* Sweep the threshold and scale options over the corpus, every setting 
+* decoding all of it on all the threads: a grid of window size, offset and 
+* scale size first, then the flex percents and the confidence floor varied 
+* one at a time around each point of its Pareto frontier. A setting is on the frontier when no other 
+* reads as many tags in less time per image (mean Stats::total). 
+* The profile is the fastest setting reading target percent of the tags 
+* (-1: as many as the defaults) and misreading no more than the defaults 
+* times are wall clock, so use no more threads than cores 
+*/
+static int
+tune(vector<Benchimage> &images, int threads, int truths, int target, string profile)
+{
+	static const int windows[] = { 32, 48, 64 };
+	static const int offsets[] = { 5, 10, 15, 20 };
+	static const int scales[]  = { 240, 320, 480 };
+	static const int flexes[]  = { 0, 15 };	//PIXMAP_SCALE_FLEX_PERCENT
+	static const int boxes[]   = { 20, 40 };	//ANCHOR_ and SHAPE_BOX_FLEX_PERCENT
+	static const int floors[]  = { 5, 15 };	//PATTERN_CONFIDENCE_FLOOR
+
+	Config defaults;
+	Variant base = makeVariant("", threads, defaults.THRESHOLD_WINDOW_SIZE, 
+		defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE);
+	vector<Variantresult> results;
+	set<string> tried;
+	trySetting(base, images, results, tried);
+	for(int w = 0; w < 3; w++){
+		for(int o = 0; o < 4; o++){
+			for(int s = 0; s < 3; s++){
+				Variant v = base;
+				v.window = windows[w];
+				v.offset = offsets[o];
+				v.scale_size = scales[s];
+				trySetting(v, images, results, tried);
+			}
+		}
+	}
+	vector<int> front = frontier(results, truths);
+	for(size_t f = 0; f < front.size(); f++){
+		Variant around = results[front[f]].variant;
+		for(int i = 0; i < 2; i++){
+			Variant v = around;
+			v.scale_flex = flexes[i];
+			trySetting(v, images, results, tried);
+			v = around;
+			v.anchor_flex = boxes[i];
+			trySetting(v, images, results, tried);
+			v = around;
+			v.shape_flex = boxes[i];
+			trySetting(v, images, results, tried);
+			v = around;
+			v.floor = floors[i];
+			trySetting(v, images, results, tried);
+		}
+	}
+	cerr << endl;
+	front = frontier(results, truths);
+
+	Variantresult &defaulted = results[0];
+	int total = truths > 0 ? truths : (int) images.size();
+	int need  = target < 0 ? tagsRead(defaulted, truths) : ((total * target) + 99) / 100;
+	int chosen = -1;
+	for(size_t i = 0; i < results.size(); i++){
+		Variantresult &r = results[i];
+		if( tagsRead(r, truths) < need || r.wrong > defaulted.wrong ) continue;
+		if( chosen < 0 || r.mean < results[chosen].mean ) chosen = (int) i;
+	}
+
+	cout << images.size() << " images, " << truths << " with ground truth, " 
+		<< results.size() << " settings, target " << need << " of " << total << " read" << endl;
+	cout << setw(7) << "window" << setw(7) << "offset" << setw(7) << "scale" << setw(7) << "sflex"
+		<< setw(7) << "aflex" << setw(7) << "bflex" << setw(7) << "floor" << setw(9) << "ms/img" << setw(9) << "p95 ms"
+		<< setw(9) << "decoded" << setw(9) << "correct" << setw(7) << "wrong" << endl;
+	for(size_t f = 0; f < front.size(); f++){
+		Variantresult &r = results[front[f]];
+		Variant &v = r.variant;
+		cout << setw(7) << v.window << setw(7) << v.offset << setw(7) << v.scale_size 
+			<< setw(7) << v.scale_flex << setw(7) << v.anchor_flex << setw(7) << v.shape_flex << setw(7) << v.floor
+			<< fixed << setprecision(2) << setw(9) << r.mean << setw(9) << r.p95
+			<< setw(9) << r.decoded << setw(9) << r.correct << setw(7) << r.wrong
+			<< (front[f] == chosen ? "  <- profile" : "") << (front[f] == 0 ? "  (defaults)" : "") << endl;
+	}
+	if( find(front.begin(), front.end(), 0) == front.end() ){
+		cout << "defaults: " << fixed << setprecision(2) << defaulted.mean << " ms/img, " 
+			<< defaulted.decoded << " decoded, " << defaulted.correct << " correct, " 
+			<< defaulted.wrong << " wrong" << endl;
+	}
+	if( chosen < 0 ){
+		cerr << "no setting reaches the target" << endl;
+		return 2;
+	}
+	Variantresult &best = results[chosen];
+	if( find(front.begin(), front.end(), chosen) == front.end() ) 
+		cout << "profile " << best.variant.name << " is off the frontier, the faster settings misread more" << endl;
+
+	Config *tuned = new Config();
+	setOptions(tuned, best.variant);
+	ofstream file;
+	if( profile.size() > 0 ){
+		file.open(profile.c_str());
+		if( ! file ){
+			cerr << "can't write " << profile << endl;
+			delete tuned;
+			return 1;
+		}
+	}
+	ostream &out = profile.size() > 0 ? (ostream &) file : cout;
+	out << "# throughput tune: " << tagsRead(best, truths) << " of " << total << " read, " 
+		<< best.wrong << " wrong, " << fixed << setprecision(2) << best.mean << " ms per image" << endl;
+	tuned->writeProfile(out);
+	delete tuned;
+	return 0;
+}
+
+struct Streamresult {
+	int read;		//frames with a complete tag
+	int correct;		//the code shown, anchor box where it was drawn
+	int wrong;		//another code
+	int misplaced;		//the code shown, anchor box elsewhere
+	int tracked;		//read in the tracking window (Stats::tracked)
+	int new_tags;		//isNewTag() reports
+	double mean;		//msecs per frame
+};
+
+//centres within half the drawn anchor size, sizes within a factor of two
+static bool
+boxNear(int *got, int *want)
+{
+	int size  = want[2] > want[3] ? want[2] : want[3];
+	int gsize = got[2] > got[3] ? got[2] : got[3];
+	int dx = abs((got[0] + (got[2] / 2)) - (want[0] + (want[2] / 2)));
+	int dy = abs((got[1] + (got[3] / 2)) - (want[1] + (want[3] / 2)));
+	return dx <= size / 2 && dy <= size / 2 && gsize * 2 >= size && gsize <= size * 2;
+}
+
+/* 
+* 640x480 frames, the card moving from the top left corner to the bottom 
+* right one and back up, touching the frame edges on the way, its code 
+* changing half way (a new card held up) 
+*/
+static Streamresult
+runStream(int frames, bool tracking)
+{
+	static const int width = 640, height = 480, percent = 60;
+	Streamresult r;
+	r.read = r.correct = r.wrong = r.misplaced = r.tracked = r.new_tags = 0;
+	Decoder *decoder = new Decoder((unsigned char *) NULL, 0);
+	decoder->getConfig()->STREAM_TRACKING = tracking;
+	Stats stats;
+	long long sum = 0;
+	int half = ((height * percent) / 100) / 2;
+	int span = frames > 1 ? frames - 1 : 1;
+	for(int f = 0; f < frames; f++){
+		Generator *generator = new Generator();
+		generator->WIDTH = width;
+		generator->HEIGHT = height;
+		generator->TAG_PERCENT = percent;
+		generator->SEED = f < frames / 2 ? 1 : 2;
+		generator->TILT = (f % 9) - 4;
+		generator->NOISE = 4;
+		generator->CLUTTER = 2;
+		generator->CENTER_X = half + (((width - (2 * half)) * f) / span);
+		int down = (2 * f) <= span ? 2 * f : 2 * (span - f); //down and back up
+		generator->CENTER_Y = half + (((height - (2 * half)) * down) / span);
+		int code[12], tag[12], want[4], got[4];
+		generator->randomCode(code);
+		generator->render(code);
+		generator->anchorBox(want);
+		bool found = decoder->processFrame(generator->getBuffer(), width, height, width);
+		decoder->copyStats(&stats);
+		sum += stats.total;
+		if( found ){
+			decoder->copyTag(tag);
+			decoder->copyTagBox(got);
+			r.read++;
+			if( memcmp(tag, code, sizeof(tag)) != 0 ) r.wrong++;
+			else if( ! boxNear(got, want) ) r.misplaced++;
+			else r.correct++;
+			if( stats.tracked ) r.tracked++;
+			if( decoder->isNewTag() ) r.new_tags++;
+		}
+		delete generator;
+	}
+	delete decoder;
+	r.mean = frames > 0 ? sum / 1000.0 / frames : 0;
+	return r;
+}
+
+/* 
+* the frame sequence with tracking and with the whole frame searched every 
+* time: every frame read must be right (code and anchor box), each of the two 
+* codes reported new once, and tracking must read as many frames as the 
+* whole frame search; exit code 2 otherwise 
+*/
+static int
+streamTest(int frames)
+{
+	Streamresult results[2];
+	results[0] = runStream(frames, true);
+	results[1] = runStream(frames, false);
+	bool gate = true;
+	cout << frames << " frames 640x480, the code changes at frame " << frames / 2 << endl;
+	cout << setw(12) << left << "mode" << right << setw(10) << "ms/frame" << setw(7) << "read"
+		<< setw(9) << "correct" << setw(7) << "wrong" << setw(10) << "misplaced"
+		<< setw(9) << "tracked" << setw(5) << "new" << setw(6) << "gate" << endl;
+	for(int i = 0; i < 2; i++){
+		Streamresult &r = results[i];
+		bool pass = r.wrong == 0 && r.misplaced == 0 && r.read > 0 && r.new_tags == 2;
+		if( i == 0 ) pass = pass && r.read >= results[1].read;
+		if( ! pass ) gate = false;
+		cout << setw(12) << left << (i == 0 ? "tracking" : "whole-frame") << right 
+			<< fixed << setprecision(2) << setw(10) << r.mean << setw(7) << r.read
+			<< setw(9) << r.correct << setw(7) << r.wrong << setw(10) << r.misplaced
+			<< setw(9) << r.tracked << setw(5) << r.new_tags << setw(6) << (pass ? "PASS" : "FAIL") << endl;
+	}
+	return gate ? 0 : 2;
+}
+
+struct Tileresult {
+	int images;
+	int tags;		//drawn
+	int found;		//the code of a tile, anchor box where it was drawn
+	int misplaced;		//the code of a tile, anchor box elsewhere
+	int wrong;		//a code not drawn, or a tile reported twice
+	long long sum;		//usecs, Stats::total
+};
+
+/* 
+* cols x rows tiles of one card each (a shelf or poster photo), rotations and 
+* tilts varying from tile to tile, decoded with one processTags() pass 
+*/
+static void
+runTiles(int cols, int rows, unsigned int seed, Tileresult *r)
+{
+	static const int tile = 320, percent = 60;
+	int width = cols * tile, height = rows * tile, ntiles = cols * rows;
+	unsigned char *luma = new unsigned char[width * height];
+	int *codes = new int[ntiles * 12];
+	int *boxes = new int[ntiles * 4];
+	bool *seen = new bool[ntiles];
+	for(int t = 0; t < ntiles; t++){
+		int x = (t % cols) * tile, y = (t / cols) * tile;
+		Generator *generator = new Generator();
+		generator->WIDTH = tile;
+		generator->HEIGHT = tile;
+		generator->TAG_PERCENT = percent;
+		generator->SEED = seed + t;
+		generator->ROTATION = t % 4;
+		generator->TILT = (t % 5) - 2;
+		generator->NOISE = 4;
+		generator->CLUTTER = 0;
+		generator->randomCode(codes + (t * 12));
+		generator->render(codes + (t * 12));
+		generator->anchorBox(boxes + (t * 4));
+		boxes[(t * 4) + 0] += x;
+		boxes[(t * 4) + 1] += y;
+		unsigned char *from = generator->getBuffer();
+		for(int j = 0; j < tile; j++) memcpy(luma + ((y + j) * width) + x, from + (j * tile), tile);
+		seen[t] = false;
+		delete generator;
+	}
+	Decoder *decoder = new Decoder(luma, width, height, width);
+	//each tile gets the grid a single tag image gets
+	decoder->getConfig()->PIXMAP_SCALE_SIZE *= cols > rows ? cols : rows;
+	decoder->processTags();
+	Stats stats;
+	decoder->copyStats(&stats);
+	r->sum += stats.total;
+	r->images++;
+	r->tags += ntiles;
+	for(int i = 0; i < decoder->getTagCount(); i++){
+		int tag[12], box[4], match = -1;
+		decoder->copyTag(i, tag);
+		decoder->copyTagBox(i, box);
+		for(int t = 0; t < ntiles && match < 0; t++){
+			if( ! seen[t] && memcmp(tag, codes + (t * 12), sizeof(tag)) == 0 ) match = t;
+		}
+		if( match < 0 ){
+			r->wrong++;
+			continue;
+		}
+		seen[match] = true;
+		if( boxNear(box, boxes + (match * 4)) ) r->found++;
+		else r->misplaced++;
+	}
+	delete decoder;
+	delete [] seen;
+	delete [] boxes;
+	delete [] codes;
+	delete [] luma;
+}
+
+/* 
+* count images cycling through the 2x1, 2x2, 3x2 and 3x3 layouts: every tile 
+* must be read with its anchor box and nothing else reported, exit code 2 
+* otherwise 
+*/
+static int
+tilesTest(int count)
+{
+	static const int layouts[4][2] = { {2, 1}, {2, 2}, {3, 2}, {3, 3} };
+	Tileresult results[4];
+	memset(results, 0, sizeof(results));
+	for(int i = 0; i < count; i++){
+		int l = i % 4;
+		runTiles(layouts[l][0], layouts[l][1], (i * 16) + 1, &results[l]);
+	}
+	bool gate = true;
+	cout << count << " images of 320x320 tiles, one processTags() pass each" << endl;
+	cout << setw(8) << left << "layout" << right << setw(9) << "ms/image" << setw(8) << "images"
+		<< setw(6) << "tags" << setw(7) << "found" << setw(8) << "missed" << setw(10) << "misplaced"
+		<< setw(7) << "wrong" << setw(6) << "gate" << endl;
+	for(int l = 0; l < 4; l++){
+		Tileresult &r = results[l];
+		if( r.images == 0 ) continue;
+		int missed = r.tags - r.found - r.misplaced;
+		bool pass = missed == 0 && r.misplaced == 0 && r.wrong == 0;
+		if( ! pass ) gate = false;
+		ostringstream layout;
+		layout << layouts[l][0] << "x" << layouts[l][1];
+		cout << setw(8) << left << layout.str() << right << fixed << setprecision(2) 
+			<< setw(9) << r.sum / 1000.0 / r.images << setw(8) << r.images
+			<< setw(6) << r.tags << setw(7) << r.found << setw(8) << missed << setw(10) << r.misplaced
+			<< setw(7) << r.wrong << setw(6) << (pass ? "PASS" : "FAIL") << endl;
+	}
+	return gate ? 0 : 2;
+}
+
+static void
+printResults(vector<Variantresult> &results, int count, int truths, int rejected, bool json)
+{
+	Variantresult &base = results[0];
+	if( json ){
+		cout << "{\"images\": " << count << ", \"ground_truth\": " << truths 
+			<< ", \"gate_on\": \"" << (truths > 0 ? "correct" : "decoded") << "\""
+			<< ", \"rejected\": " << rejected << ", \"variants\": [" << endl;
+		for(size_t i = 0; i < results.size(); i++){
+			Variantresult &r = results[i];
+			cout << "  {\"name\": \"" << r.variant.name << "\", \"threads\": " << r.variant.threads
+				<< ", \"window\": " << r.variant.window
+				<< ", \"fast_scale\": " << (r.variant.fast_scale ? "true" : "false")
+				<< ", \"jpg_scale\": " << (r.variant.jpg_scale ? "true" : "false")
+				<< ", \"seconds\": " << r.seconds << ", \"images_per_sec\": " << r.images_per_sec
+				<< ", \"speedup\": " << (base.images_per_sec > 0 ? r.images_per_sec / base.images_per_sec : 0)
+				<< ", \"p50_ms\": " << r.p50 << ", \"p95_ms\": " << r.p95 << ", \"p99_ms\": " << r.p99
+				<< ", \"peak_rss_kb\": " << r.peak_rss
+				<< ", \"decoded\": " << r.decoded << ", \"correct\": " << r.correct
+				<< ", \"wrong\": " << r.wrong << ", \"pass\": " << (r.pass ? "true" : "false") << "}"
+				<< (i + 1 < results.size() ? "," : "") << endl;
+		}
+		cout << "]}" << endl;
+		return;
+	}
+	cout << count << " images, " << truths << " with ground truth, " 
+		<< rejected << " rejected by the header probe" << endl;
+	if( truths == 0 ) cout << "no ground truth, the gate compares the tags decoded" << endl;
+	cout << setw(16) << left << "variant" << right << setw(10) << "img/s" << setw(9) << "speedup"
+		<< setw(9) << "p50 ms" << setw(9) << "p95 ms" << setw(9) << "p99 ms"
+		<< setw(11) << "peak KB" << setw(9) << "decoded" << setw(9) << "correct"
+		<< setw(7) << "wrong" << setw(6) << "gate" << endl;
+	for(size_t i = 0; i < results.size(); i++){
+		Variantresult &r = results[i];
+		cout << setw(16) << left << r.variant.name << right << fixed << setprecision(1)
+			<< setw(10) << r.images_per_sec
+			<< setprecision(2)
+			<< setw(9) << (base.images_per_sec > 0 ? r.images_per_sec / base.images_per_sec : 0)
+			<< setw(9) << r.p50 << setw(9) << r.p95 << setw(9) << r.p99
+			<< setw(11) << r.peak_rss << setw(9) << r.decoded << setw(9) << r.correct
+			<< setw(7) << r.wrong << setw(6) << (r.pass ? "PASS" : "FAIL") << endl;
+	}
+}
+
+int main(int argc,char **argv) {
+	if( argc < 2 ){
+		cerr << endl;
+		cerr << "Usage:" << endl;
+		cerr << "\t" << argv[0] << " corpusdir|gen [max threads] [image count] [j]" << endl;
+		cerr << "\t" << argv[0] << " corpusdir|gen [max threads] [image count] tune [target percent] [profile]" << endl;
+		cerr << "\t" << argv[0] << " gen 1 [frame count] stream" << endl;
+		cerr << "\t" << argv[0] << " gen 1 [image count] tiles" << endl;
+		cerr << endl;
+		cerr << "\tcorpusdir: jpg/png/pnm files, ground truth from corpusdir/truth.txt (gentag output)" << endl;
+		cerr << "\tgen: render image count synthetic tags in memory (default 40)" << endl;
+		cerr << "\tj: JSON output" << endl;
+		cerr << "\ttune: sweep the threshold and scale options, write the fastest reaching" << endl;
+		cerr << "\t      target percent (default: as many as the defaults) as a profile" << endl;
+		cerr << "\tstream: generated frames through processFrame(), codes, boxes and tracking checked" << endl;
+		cerr << "\ttiles: generated multi tag images through processTags(), codes and boxes checked" << endl;
+		cerr << endl;
+		return 1;
+	}
+	int max_threads = argc >= 3 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 4;
+	int count = argc >= 4 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 40;
+	bool json = argc >= 5 && strcmp(argv[4], "j") == 0;
+	bool tuning = argc >= 5 && strcmp(argv[4], "tune") == 0;
+	int target = argc >= 6 ? atoi(argv[5]) : -1;
+	string profile = argc >= 7 ? argv[6] : "";
+	if( argc >= 5 && strcmp(argv[4], "stream") == 0 ){
+		if( strcmp(argv[1], "gen") != 0 ){
+			cerr << "stream generates its frames, use gen" << endl;
+			return 1;
+		}
+		return streamTest(count);
+	}
+	if( argc >= 5 && strcmp(argv[4], "tiles") == 0 ){
+		if( strcmp(argv[1], "gen") != 0 ){
+			cerr << "tiles generates its images, use gen" << endl;
+			return 1;
+		}
+		return tilesTest(count);
+	}
+#ifndef PTHREAD
+	max_threads = 1;
+#endif
+
+	vector<Benchimage> images;
+	bool loaded = strcmp(argv[1], "gen") == 0 ?
+		loadGenerated(count, images) : loadDirectory(argv[1], images);
+	if( ! loaded ){
+		cerr << "no images to decode" << endl;
+		return 1;
+	}
+	int truths = 0;
+	for(size_t i = 0; i < images.size(); i++) if( images[i].has_truth ) truths++;
+
+	Config defaults;
+	int rejected = 0;
+	for(size_t i = 0; i < images.size(); i++){
+		Probe probe;
+		if( probe.probe(&defaults, images[i].data, images[i].size) != PROBE_OK ) rejected++;
+		images[i].cost = probe.COST;
+	}
+	stable_sort(images.begin(), images.end(), costlier);
+
+	if( tuning ){
+		int status = tune(images, max_threads, truths, target, profile);
+		releaseImages(images);
+		return status;
+	}
+
+	int window = defaults.THRESHOLD_WINDOW_SIZE;
+	vector<Variant> variants;
+	variants.push_back(makeVariant("baseline", 1, window, defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE));
+	for(int t = 2; t <= max_threads; t *= 2){
+		ostringstream name;
+		name << "threads-" << t;
+		variants.push_back(makeVariant(name.str(), t, window, defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE));
+		if( t < max_threads && t * 2 > max_threads ){
+			ostringstream last;
+			last << "threads-" << max_threads;
+			variants.push_back(makeVariant(last.str(), max_threads, window, defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE));
+		}
+	}
+	variants.push_back(makeVariant("no-jpg-scale", 1, window, defaults.PIXMAP_FAST_SCALE, false));
+	variants.push_back(makeVariant("slow-scale", 1, window, false, defaults.JPG_SCALE));
+	variants.push_back(makeVariant("window-32", 1, 32, defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE));
+	variants.push_back(makeVariant("window-64", 1, 64, defaults.PIXMAP_FAST_SCALE, defaults.JPG_SCALE));
+
+	vector<Variantresult> results;
+	bool gate = true;
+	for(size_t i = 0; i < variants.size(); i++){
+		results.push_back(runVariant(variants[i], images));
+		Variantresult &r = results.back();
+		if( truths > 0 ) r.pass = i == 0 || (r.correct >= results[0].correct && r.wrong <= results[0].wrong);
+		else             r.pass = i == 0 || r.decoded >= results[0].decoded; //nothing to be wrong against
+		if( ! r.pass ) gate = false;
+	}
+
+	printResults(results, (int) images.size(), truths, rejected, json);
+	releaseImages(images);
+	return gate ? 0 : 2;
+}
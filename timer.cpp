@@ -0,0 +1,28 @@
+#include "timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+long long
+Timer::now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (long long)((double)count.QuadPart * 1000000.0 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#endif
+}
+
+long long
+Timer::nowMillis()
+{
+	return now() / 1000;
+}
@@ -0,0 +1,15 @@
+#ifndef _TIMER_H_INCLUDED
+#define _TIMER_H_INCLUDED
+
+#include "common.h"
+
+/* monotonic clock for deadlines and stage timing, not wall clock time */
+class Timer
+{
+
+public:
+	static long long now();		//microseconds since an arbitrary fixed point 
+	static long long nowMillis();	//milliseconds since the same point 
+};
+
+#endif /* _TIMER_H_INCLUDED */
@@ -0,0 +1,145 @@
+#include "workqueue.h"
+
+#ifdef PTHREAD
+
+/* c function and struct for pthread */
+struct worker_data {
+	int id;
+	Workqueue *queue;
+};
+
+void*
+workqueueWorker(void *arg)
+{
+	struct worker_data *task = (struct worker_data*) arg;
+	task->queue->runWorker(task->id);
+	delete task;
+	return NULL;
+}
+
+Workqueue::Workqueue(int _workers, int _size)
+{
+	workers  = _workers > 0 ? _workers : 1;
+	size     = _size > 0 ? _size : 1;
+	head     = 0;
+	count    = 0;
+	started  = 0;
+	stopping = false;
+	jobs     = new job[size];
+	threads  = new pthread_t[workers];
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&not_empty, NULL);
+	pthread_cond_init(&not_full, NULL);
+
+	for(int i = 0; i < workers; i++){
+		struct worker_data *task = new worker_data;
+		task->id = i;
+		task->queue = this;
+		if (pthread_create(&threads[i], NULL, workqueueWorker, (void *)task) != 0){
+			delete task;
+			break;
+		}
+		started++;
+	}
+}
+
+Workqueue::~Workqueue()
+{
+	shutdown();
+	pthread_cond_destroy(&not_full);
+	pthread_cond_destroy(&not_empty);
+	pthread_mutex_destroy(&lock);
+	delete [] threads;
+	delete [] jobs;
+}
+
+int
+Workqueue::getWorkers()
+{
+	return started;
+}
+
+int
+Workqueue::getQueued()
+{
+	pthread_mutex_lock(&lock);
+	int queued = count;
+	pthread_mutex_unlock(&lock);
+	return queued;
+}
+
+//call with lock held and a free slot
+void
+Workqueue::enqueue(Workfunc work, void *arg)
+{
+	int tail = (head + count) % size;
+	jobs[tail].work = work;
+	jobs[tail].arg  = arg;
+	count++;
+	pthread_cond_signal(&not_empty);
+}
+
+bool
+Workqueue::submit(Workfunc work, void *arg)
+{
+	pthread_mutex_lock(&lock);
+	while( count == size && ! stopping ) pthread_cond_wait(&not_full, &lock);
+	if( stopping || started == 0 ){
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+	enqueue(work, arg);
+	pthread_mutex_unlock(&lock);
+	return true;
+}
+
+bool
+Workqueue::trySubmit(Workfunc work, void *arg)
+{
+	pthread_mutex_lock(&lock);
+	if( count == size || stopping || started == 0 ){
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+	enqueue(work, arg);
+	pthread_mutex_unlock(&lock);
+	return true;
+}
+
+void
+Workqueue::shutdown()
+{
+	pthread_mutex_lock(&lock);
+	if( stopping ){
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	stopping = true;
+	pthread_cond_broadcast(&not_empty);
+	pthread_cond_broadcast(&not_full);
+	pthread_mutex_unlock(&lock);
+	for(int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+}
+
+void
+Workqueue::runWorker(int id)
+{
+	job next;
+	for(;;){
+		pthread_mutex_lock(&lock);
+		while( count == 0 && ! stopping ) pthread_cond_wait(&not_empty, &lock);
+		if( count == 0 ){ //stopping and drained
+			pthread_mutex_unlock(&lock);
+			return;
+		}
+		next = jobs[head];
+		head = (head + 1) % size;
+		count--;
+		pthread_cond_signal(&not_full);
+		pthread_mutex_unlock(&lock);
+		next.work(next.arg, id);
+	}
+}
+
+#endif /* PTHREAD */
@@ -0,0 +1,56 @@
+#ifndef _WORKQUEUE_H_INCLUDED
+#define _WORKQUEUE_H_INCLUDED
+
+#include "threshold.h" //PTHREAD switch
+#include "common.h"
+
+#ifdef PTHREAD
+
+#include <pthread.h>
+
+using namespace std;
+
+/* 
+* fixed pool of worker threads draining a bounded FIFO of jobs
+* submit() blocks while the queue is full, which is the back-pressure
+* for the producer (stop reading more requests until a worker frees up)
+*
+* a job is a plain function and argument pair, the worker id (0..workers-1)
+* is passed along so callers can keep one context per worker
+*/
+
+typedef void (*Workfunc)(void *arg, int worker);
+
+class Workqueue
+{
+
+public:
+	Workqueue(int workers, int size);
+	~Workqueue();				//finishes all queued jobs before returning
+	bool submit(Workfunc work, void *arg);	//blocks while full, false after shutdown
+	bool trySubmit(Workfunc work, void *arg);	//false if full, never blocks
+	int  getWorkers();
+	int  getQueued();
+	void shutdown();			//no new jobs, wait for workers to drain the queue
+	void runWorker(int id);			//worker thread body, not for direct use
+
+private:
+	struct job {
+		Workfunc work;
+		void *arg;
+	};
+	job *jobs;
+	int size, head, count;
+	int workers, started;
+	bool stopping;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+
+	void enqueue(Workfunc work, void *arg);
+};
+
+#endif /* PTHREAD */
+
+#endif /* _WORKQUEUE_H_INCLUDED */